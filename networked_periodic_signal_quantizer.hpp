@@ -2,7 +2,41 @@
 #define NETWORKED_PERIODIC_SIGNAL_QUANTIZER_HPP
 
 #include "sbpt_generated_includes.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <condition_variable>
+#include <cstdint>
 #include <deque>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NPSQ_HAS_POSIX_SHARED_MEMORY 1 // also covers the mmap backed spill buffer
+#endif
 
 /*
  * Before networking gets fully involved I want to  preface this with the concept that clocks on two different computers
@@ -62,155 +96,3424 @@
  * having an empty buffer, and in that case the best thing is pretend like you're starting up again in the variance
  * case, so wait until you have 1
  *
- * TODO: we still need a solution for an overflowing client buffer and how we deal with that... Probably if it gets too
- * large we should process or remove a bunch at once to bring it back down.
+ * An overflowing client buffer is handled by `max_buffered_states`, once the buffer grows past it the oldest states are
+ * dropped to bring it back down.
  *
  */
 
 /**
- * @brief A networked periodic signal quantizer for processing and emitting server states at a controlled rate.
+ * @brief O(1) bookkeeping of the interval between consecutive arrivals.
  *
- * This templated class buffers states received from a server and emits them at a regular interval
- * defined by an internal `PeriodicSignal`. It is designed to take incoming server data that is being sent at a fixed
- * rate, but due to network variance might not be received at a steady rate, and act as an adapter that takes this noisy
- * signal and actually emits the data at a fixed frequency by buffering a few elements so there is always something to
- * grab.
+ * Every call to `record_arrival` only updates a handful of running moments (Welford's algorithm), the mean, standard
+ * deviation and extremes are derived from those moments when they're actually queried. This replaces pressing a full
+ * `Stopwatch` on every packet, which keeps its whole history around and recomputes statistics over it.
+ */
+class ArrivalIntervalStatistics {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    void record_arrival() { record_arrival(clock::now()); }
+
+    void record_arrival(clock::time_point arrival_time) {
+        if (has_previous_arrival) {
+            double interval_us =
+                std::chrono::duration<double, std::micro>(arrival_time - previous_arrival_time).count();
+
+            num_intervals++;
+            double delta = interval_us - running_mean_us;
+            running_mean_us += delta / static_cast<double>(num_intervals);
+            running_sum_of_squared_deviations += delta * (interval_us - running_mean_us);
+
+            min_interval_us = std::min(min_interval_us, interval_us);
+            max_interval_us = std::max(max_interval_us, interval_us);
+        }
+
+        has_previous_arrival = true;
+        previous_arrival_time = arrival_time;
+    }
+
+    void reset() { *this = ArrivalIntervalStatistics(); }
+
+    size_t get_interval_count() const { return num_intervals; }
+    bool has_arrivals() const { return has_previous_arrival; }
+    clock::time_point get_last_arrival_time() const { return previous_arrival_time; }
+
+    double get_mean_interval_us() const { return num_intervals == 0 ? 0.0 : running_mean_us; }
+
+    double get_interval_stddev_us() const {
+        if (num_intervals < 2)
+            return 0.0;
+        return std::sqrt(running_sum_of_squared_deviations / static_cast<double>(num_intervals - 1));
+    }
+
+    double get_min_interval_us() const { return num_intervals == 0 ? 0.0 : min_interval_us; }
+    double get_max_interval_us() const { return num_intervals == 0 ? 0.0 : max_interval_us; }
+
+    /// @brief the arrival rate implied by the mean interval, or 0 if we haven't seen two arrivals yet
+    double get_mean_rate_hz() const {
+        double mean_us = get_mean_interval_us();
+        return mean_us <= 0.0 ? 0.0 : 1'000'000.0 / mean_us;
+    }
+
+  private:
+    bool has_previous_arrival = false;
+    clock::time_point previous_arrival_time{};
+
+    size_t num_intervals = 0;
+    double running_mean_us = 0.0;
+    double running_sum_of_squared_deviations = 0.0;
+    double min_interval_us = std::numeric_limits<double>::max();
+    double max_interval_us = 0.0;
+};
+
+/**
+ * @brief Estimates the recent arrival rate from exponentially decayed sums of the time between arrivals and the number
+ * of states each arrival accounts for, so unlike a lifetime mean it follows the sender's rate as it changes.
  *
- * @warn This does not solve the issue when the internet connection is lost for a few seconds or anything like that, as
- * it only buffers a few elements, in such cases the buffer will be depleted and then the output emitter will output
- * nullopt values in the output emitter
+ * Jitter mostly cancels out since a late arrival shortens the interval after it. An arrival that comes after lost
+ * states can say how many states it covers so loss doesn't look like a slower sender, and an interval much longer than
+ * the current estimate is treated as an outage and ignored.
+ */
+class ArrivalRateEstimator {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /// @param time_constant roughly how far back the estimate looks
+    explicit ArrivalRateEstimator(std::chrono::duration<double> time_constant = std::chrono::seconds(30))
+        : time_constant_s(time_constant.count()) {}
+
+    /// @brief intervals longer than this many times the current mean interval are considered outages
+    double outage_interval_factor = 8.0;
+
+    void record_arrival(clock::time_point arrival_time, size_t num_states_since_previous = 1) {
+        if (has_previous_arrival and num_states_since_previous != 0) {
+            double interval_s = std::chrono::duration<double>(arrival_time - previous_arrival_time).count();
+            double mean_interval_s = get_rate_hz() <= 0.0 ? 0.0 : 1.0 / get_rate_hz();
+            bool is_outage = mean_interval_s > 0.0 and interval_s > outage_interval_factor * mean_interval_s *
+                                                                       static_cast<double>(num_states_since_previous);
+            if (not is_outage) {
+                double decay = time_constant_s <= 0.0 ? 0.0 : std::exp(-interval_s / time_constant_s);
+                decayed_duration_s = decayed_duration_s * decay + interval_s;
+                decayed_state_count = decayed_state_count * decay + static_cast<double>(num_states_since_previous);
+            }
+        }
+
+        has_previous_arrival = true;
+        previous_arrival_time = arrival_time;
+    }
+
+    /// @brief states per second over roughly the last time constant, 0 until two arrivals have been seen
+    double get_rate_hz() const { return decayed_duration_s <= 0.0 ? 0.0 : decayed_state_count / decayed_duration_s; }
+
+  private:
+    double time_constant_s;
+
+    bool has_previous_arrival = false;
+    clock::time_point previous_arrival_time{};
+    double decayed_duration_s = 0.0;
+    double decayed_state_count = 0.0;
+};
+
+/**
+ * @brief A diagnostic message whose formatting has been deferred.
  *
+ * Only the raw arguments are captured on the hot thread, `format` is a captureless lambda that knows the format string
+ * and does the real `global_logger` call later on.
+ */
+struct DeferredDiagnosticRecord {
+    using Formatter = void (*)(const DeferredDiagnosticRecord &);
+    static constexpr size_t max_arguments = 3;
+
+    Formatter format = nullptr;
+    std::array<size_t, max_arguments> arguments{};
+};
+
+/**
+ * @brief single producer single consumer lock-free ring of deferred diagnostic records
  *
- * @tparam T The type of the server state to be buffered and emitted.
+ * @note when the ring is full new records are dropped and counted rather than blocking the producer, we'd rather lose
+ * a log line than change the timing we are trying to observe.
+ */
+class DeferredDiagnosticRing {
+  public:
+    static constexpr size_t capacity = 4096; // must be a power of two
+
+    bool try_push(const DeferredDiagnosticRecord &record) {
+        size_t tail = write_index.load(std::memory_order_relaxed);
+        if (tail - read_index.load(std::memory_order_acquire) == capacity) {
+            dropped_records.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        records[tail & (capacity - 1)] = record;
+        write_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(DeferredDiagnosticRecord &record) {
+        size_t head = read_index.load(std::memory_order_relaxed);
+        if (head == write_index.load(std::memory_order_acquire))
+            return false;
+        record = records[head & (capacity - 1)];
+        read_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return read_index.load(std::memory_order_acquire) == write_index.load(std::memory_order_acquire);
+    }
+
+    size_t take_dropped_count() { return dropped_records.exchange(0, std::memory_order_relaxed); }
+
+  private:
+    std::array<DeferredDiagnosticRecord, capacity> records{};
+    alignas(64) std::atomic<size_t> write_index{0};
+    alignas(64) std::atomic<size_t> read_index{0};
+    std::atomic<size_t> dropped_records{0};
+};
+
+/**
+ * @brief Collects deferred diagnostic records from every thread and formats them on a background thread.
  *
- * @details
- * The class maintains a deque of received states (`received_server_states`) and uses a `Stopwatch`
- * (`empirical_server_signal_stopwatch`) to measure the actual arrival times of these states. It emits
- * quantized output signals via a `SignalEmitter` (`output_emitter`) according to a `PeriodicSignal`
- * (`quantized_output_signal`). The class also tracks whether the buffer was empty on the previous update
- * and computes an exponential moving average of the buffer size for monitoring purposes.
+ * Each producing thread lazily gets its own `DeferredDiagnosticRing` the first time it records something, so recording
+ * is a handful of stores and never takes a lock after that. The background thread drains all rings and hands the
+ * records to `global_logger`.
+ */
+class DeferredDiagnosticsLogger {
+  public:
+    static DeferredDiagnosticsLogger &get() {
+        static DeferredDiagnosticsLogger instance;
+        return instance;
+    }
+
+    DeferredDiagnosticsLogger(const DeferredDiagnosticsLogger &) = delete;
+    DeferredDiagnosticsLogger &operator=(const DeferredDiagnosticsLogger &) = delete;
+
+    ~DeferredDiagnosticsLogger() {
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            stop_requested = true;
+        }
+        wake_condition.notify_one();
+        if (formatting_thread.joinable())
+            formatting_thread.join();
+    }
+
+    void record(const DeferredDiagnosticRecord &record) { get_thread_ring().try_push(record); }
+
+    /// @brief blocks until everything recorded so far has been formatted, useful before shutdown or in tests
+    void flush() { drain_all_rings(); }
+
+  private:
+    DeferredDiagnosticsLogger() : formatting_thread([this] { run_formatting_loop(); }) {}
+
+    DeferredDiagnosticRing &get_thread_ring() {
+        thread_local std::shared_ptr<DeferredDiagnosticRing> thread_ring = [this] {
+            auto ring = std::make_shared<DeferredDiagnosticRing>();
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            rings.push_back(ring);
+            return ring;
+        }();
+        return *thread_ring;
+    }
+
+    void run_formatting_loop() {
+        std::unique_lock<std::mutex> lock(rings_mutex);
+        while (not stop_requested) {
+            wake_condition.wait_for(lock, drain_interval);
+            lock.unlock();
+            drain_all_rings();
+            lock.lock();
+        }
+        lock.unlock();
+        drain_all_rings();
+    }
+
+    // NOTE: the records are only taken out of the rings under rings_mutex and formatted after releasing it, so a thread
+    // registering its ring never waits on the logger. No log section is opened here since the hot threads may have
+    // their own open
+    void drain_all_rings() {
+        // one drain at a time, so the rings keep a single consumer and flush returns only once everything is formatted
+        std::lock_guard<std::mutex> formatting_lock(formatting_mutex);
+
+        size_t num_dropped_records = 0;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            DeferredDiagnosticRecord record;
+            for (auto &ring : rings) {
+                while (ring->try_pop(record)) {
+                    drained_records.push_back(record);
+                }
+                num_dropped_records += ring->take_dropped_count();
+            }
+
+            // rings whose thread has exited are only referenced by us, once they're drained we can let them go
+            rings.erase(std::remove_if(rings.begin(), rings.end(),
+                                       [](const auto &ring) { return ring.use_count() == 1 and ring->empty(); }),
+                        rings.end());
+        }
+
+        for (const DeferredDiagnosticRecord &record : drained_records) {
+            record.format(record);
+        }
+        drained_records.clear();
+
+        if (num_dropped_records != 0) {
+            global_logger->debug("deferred diagnostics dropped {} records, the rings were full", num_dropped_records);
+        }
+    }
+
+    static constexpr std::chrono::milliseconds drain_interval{5};
+
+    std::mutex formatting_mutex;
+    // only touched while holding formatting_mutex, kept between drains so its capacity is reused
+    std::vector<DeferredDiagnosticRecord> drained_records;
+    std::mutex rings_mutex;
+    std::condition_variable wake_condition;
+    std::vector<std::shared_ptr<DeferredDiagnosticRing>> rings;
+    bool stop_requested = false;
+    std::thread formatting_thread;
+};
+
+/**
+ * @brief Controls which updates of a quantizer actually record diagnostics.
  *
- * Usage:
- * - Call `push()` whenever a new server state arrives.
- * - Call `update()` periodically to process and emit buffered states at the quantized rate.
- * - Use `get_missed_emit_percentage()` and `get_average_received_server_states_size()` for metrics.
+ * With sampling enabled only the interesting ticks are recorded: ones that miss an emit, ones where the buffer depth
+ * crosses into or out of the low/high bands, and every nth update so there's a steady heartbeat. This keeps the log
+ * volume independent of tick rate times stream count, so it can be left on.
+ */
+struct QuantizerDiagnosticsSampling {
+    /// @brief when false every push and update is recorded
+    bool enabled = false;
+    /// @brief record every nth update regardless of what happened, 0 turns this off
+    unsigned int every_nth_update = 0;
+    bool record_missed_emits = true;
+    /// @brief record whenever the depth moves into or out of [0, low_depth_threshold]
+    size_t low_depth_threshold = 1;
+    /// @brief record whenever the depth moves into or out of [high_depth_threshold, inf)
+    size_t high_depth_threshold = 8;
+};
+
+/**
+ * @brief The default instrumentation policy of a quantizer, every hook is empty and inlines away to nothing.
  *
- * @note
- * The first pushed state initializes the quantized signal timing.
+ * To attach custom counters or tracing, write a type with the same member functions and pass it as the `Hooks`
+ * template parameter of `NetworkedPeriodicSignalQuantizer`, the instance is reachable through its `hooks` member. All
+ * depths are the number of states buffered at the time the hook fires.
+ */
+struct NoQuantizerHooks {
+    /// @brief a state was pushed into the buffer
+    void on_push(size_t /*depth*/) {}
+    /// @brief a state was emitted, depth is after removing it from the buffer
+    void on_emit(size_t /*depth*/) {}
+    /// @brief it was time to emit but we were waiting for the buffer to refill
+    void on_miss(size_t /*depth*/) {}
+    /// @brief the buffer has refilled to the required amount and emitting resumes on the next opportunity
+    void on_refill_complete(size_t /*depth*/) {}
+    /// @brief the buffer grew past its maximum size and states had to be dropped
+    void on_overflow(size_t /*depth*/, size_t /*num_dropped*/) {}
+};
+
+/**
+ * @brief Records quantizer timelines as Chrome trace-event JSON, which can be opened in chrome://tracing or Perfetto.
+ *
+ * Every stream gets its own track, pushes show up as instants, each emit opportunity is a slice named either "emit" or
+ * "miss" lasting until the next opportunity, and the buffer depth is a counter. Attach it to a quantizer with
+ * `TraceEventQuantizerHooks`.
  */
-template <typename T> class NetworkedPeriodicSignalQuantizer {
+class QuantizerTraceRecorder {
   public:
-    explicit NetworkedPeriodicSignalQuantizer() {}
+    using clock = std::chrono::steady_clock;
 
-    std::deque<T> received_server_states;
+    enum class EventKind { instant, slice, counter };
 
-    /** @brief Stopwatch used to measure the timing statistics of when we receive states from the server  */
-    Stopwatch received_state_stopwatch;
+    struct Event {
+        EventKind kind;
+        const char *name; // always a string literal
+        unsigned int stream_id;
+        int64_t timestamp_us;
+        int64_t duration_us;
+        size_t depth;
+    };
 
-    /**
-     * @brief the clean smooth output signal that is used to drive the emitter
-     * @note you can use get get_cycle_progess to see how close we are to the next signal, which can be used for
-     * interpolation purposess
-     */
-    PeriodicSignal output_signal{60};
-    /// @brief the emitter which you should bind to receive the states
-    SignalEmitter output_emitter;
+    void register_stream(unsigned int stream_id, std::string name) {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        stream_names.emplace_back(stream_id, std::move(name));
+    }
 
-    bool pushed_first_element = false;
-    bool logging_enabled = false;
+    int64_t now_us() const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start_time).count();
+    }
 
-    // NOTE: the higher this is the more delay there will be, but the lower the propbability you'll not have something
-    // to grab from the buffer
-    unsigned int num_states_to_wait_for_after_empty = 4;
+    void record(const Event &event) {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        events.push_back(event);
+    }
+
+    /**
+     * @brief ends the stream's open slice (if any) at timestamp_us and opens a new one, the open slice is only
+     * recorded once the next one begins, or cut off at the time of writing by `write_json`
+     */
+    void begin_slice(unsigned int stream_id, const char *name, int64_t timestamp_us, size_t depth) {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        auto [it, inserted] = open_slices.try_emplace(stream_id);
+        Event &open_slice = it->second;
+        if (not inserted) {
+            open_slice.duration_us = timestamp_us - open_slice.timestamp_us;
+            events.push_back(open_slice);
+        }
+        open_slice = {EventKind::slice, name, stream_id, timestamp_us, 0, depth};
+    }
 
-    math_utils::ExponentialMovingAverage average_received_server_states_size;
+    void clear() {
+        std::lock_guard<std::mutex> lock(events_mutex);
+        events.clear();
+        open_slices.clear();
+    }
 
     /**
-     * @brief Push a new state into the buffer.
+     * @brief writes everything recorded so far as a trace-event JSON file, returns false if the file can't be opened
+     * @note slices that are still open are written as lasting until now, so a capture that ends on a stall shows it
      */
-    void push(const T &item) {
-        GlobalLogSection _("npsq push", logging_enabled);
+    bool write_json(const std::string &file_path) const {
+        std::ofstream out(file_path);
+        if (not out)
+            return false;
 
-        received_server_states.push_back(item);
-        received_state_stopwatch.press();
+        int64_t now = now_us();
+        std::lock_guard<std::mutex> lock(events_mutex);
 
-        if (not pushed_first_element) {
-            pushed_first_element = true;
-            output_signal.restart();
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        auto separator = [&]() -> std::ofstream & {
+            if (not first)
+                out << ",";
+            first = false;
+            return out;
+        };
+
+        for (const auto &[stream_id, name] : stream_names) {
+            separator() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << stream_id
+                        << ",\"args\":{\"name\":\"" << escape_json(name) << "\"}}";
         }
 
-        global_logger->debug("size is now: {}", received_server_states.size());
+        auto write_event = [&](const Event &event) {
+            switch (event.kind) {
+            case EventKind::instant:
+                separator() << "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"" << event.name << "\",\"pid\":1,\"tid\":"
+                            << event.stream_id << ",\"ts\":" << event.timestamp_us << ",\"args\":{\"depth\":"
+                            << event.depth << "}}";
+                break;
+            case EventKind::slice:
+                separator() << "{\"ph\":\"X\",\"name\":\"" << event.name << "\",\"pid\":1,\"tid\":"
+                            << event.stream_id << ",\"ts\":" << event.timestamp_us
+                            << ",\"dur\":" << event.duration_us << ",\"args\":{\"depth\":" << event.depth << "}}";
+                break;
+            case EventKind::counter:
+                // counters are per process in the trace-event format, so the stream id goes into the name
+                separator() << "{\"ph\":\"C\",\"name\":\"" << event.name << " " << event.stream_id
+                            << "\",\"pid\":1,\"ts\":" << event.timestamp_us << ",\"args\":{\"depth\":"
+                            << event.depth << "}}";
+                break;
+            }
+        };
 
-        received_state_stopwatch.get_micro_stats();
-        // TODO: adjust the quantlized output signal to match the server micro mean period
+        for (const auto &event : events)
+            write_event(event);
+
+        for (const auto &[stream_id, open_slice] : open_slices) {
+            Event flushed_slice = open_slice;
+            flushed_slice.duration_us = std::max<int64_t>(now - open_slice.timestamp_us, 0);
+            write_event(flushed_slice);
+        }
+
+        out << "]}\n";
+        return static_cast<bool>(out);
     }
 
-    /**
-     * @brief Call periodically to emit states at the proper rate.
-     */
-    void update() {
-        GlobalLogSection _("npsq update", logging_enabled);
+  private:
+    static std::string escape_json(const std::string &text) {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (char c : text) {
+            if (c == '"' or c == '\\') {
+                escaped += '\\';
+                escaped += c;
+            } else if (static_cast<unsigned char>(c) >= 0x20) {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    clock::time_point start_time = clock::now();
+    mutable std::mutex events_mutex;
+    std::vector<Event> events;
+    // the emit or miss slice each stream is currently in, its duration isn't known until the next one begins
+    std::unordered_map<unsigned int, Event> open_slices;
+    std::vector<std::pair<unsigned int, std::string>> stream_names;
+};
 
-        global_logger->debug("size is now: {}", received_server_states.size());
+/**
+ * @brief Hook policy that feeds a quantizer's timeline into a `QuantizerTraceRecorder` as its own track.
+ *
+ * @note until `recorder` is set every hook is a no-op
+ */
+struct TraceEventQuantizerHooks {
+    QuantizerTraceRecorder *recorder = nullptr;
+    unsigned int stream_id = 0;
 
-        if (not pushed_first_element)
+    void on_push(size_t depth) {
+        if (recorder == nullptr)
             return;
+        int64_t now = recorder->now_us();
+        recorder->record({QuantizerTraceRecorder::EventKind::instant, "push", stream_id, now, 0, depth});
+        recorder->record({QuantizerTraceRecorder::EventKind::counter, "depth", stream_id, now, 0, depth});
+    }
 
-        average_received_server_states_size.add_sample(static_cast<double>(received_server_states.size()));
+    void on_emit(size_t depth) { record_emit_opportunity("emit", depth); }
+    void on_miss(size_t depth) { record_emit_opportunity("miss", depth); }
 
-        if (output_signal.process_and_get_signal()) {
-            global_logger->debug("its time to emit a signal");
-            total_emit_opportunities++;
+    void on_refill_complete(size_t depth) {
+        if (recorder == nullptr)
+            return;
+        recorder->record(
+            {QuantizerTraceRecorder::EventKind::instant, "refill complete", stream_id, recorder->now_us(), 0, depth});
+    }
 
-            std::optional<T> emitted_value = std::nullopt;
+    void on_overflow(size_t depth, size_t /*num_dropped*/) {
+        if (recorder == nullptr)
+            return;
+        int64_t now = recorder->now_us();
+        recorder->record({QuantizerTraceRecorder::EventKind::instant, "overflow", stream_id, now, 0, depth});
+        recorder->record({QuantizerTraceRecorder::EventKind::counter, "depth", stream_id, now, 0, depth});
+    }
 
-            if (repopulate_state_buffer) {
-                global_logger->debug(
-                    "would've emitted a signal but we are waiting for {} states in the buffer before we "
-                    "get started emitting again, there are currently {}",
-                    num_states_to_wait_for_after_empty, received_server_states.size());
+  private:
+    // a slice lasts from its emit opportunity until the next one, so the track shows which periods were starved
+    void record_emit_opportunity(const char *name, size_t depth) {
+        if (recorder == nullptr)
+            return;
+        int64_t now = recorder->now_us();
+        recorder->begin_slice(stream_id, name, now, depth);
+        recorder->record({QuantizerTraceRecorder::EventKind::counter, "depth", stream_id, now, 0, depth});
+    }
+};
 
-                if (received_server_states.size() >= num_states_to_wait_for_after_empty) {
-                    repopulate_state_buffer = false;
-                }
+/**
+ * @brief Counts emit opportunities and misses in time buckets so the miss rate over the last few seconds can be read,
+ * rather than a lifetime total that barely moves after an hour.
+ *
+ * Recording only touches the current bucket (buckets that were skipped over are cleared as time moves on, which is
+ * amortized O(1)), queries sum the buckets inside the requested window.
+ */
+class WindowedEmitCounter {
+  public:
+    using clock = std::chrono::steady_clock;
 
-                missed_emit_opportunities++;
-            } else {
-                auto first = received_server_states.front();
-                emitted_value = first;
-                received_server_states.pop_front();
-                global_logger->debug("just popped, size is now: {}", received_server_states.size());
-                repopulate_state_buffer = received_server_states.empty();
-            }
+    static constexpr std::chrono::milliseconds bucket_duration{250};
+    static constexpr size_t num_buckets = 240;
+    /// @brief the longest window that can be queried
+    static constexpr std::chrono::milliseconds max_window = bucket_duration * num_buckets;
 
-            if (emitted_value == std::nullopt) {
-                global_logger->debug("emitting empty");
-            } else {
-                global_logger->debug("emitting value now");
+    void record(bool missed, clock::time_point now = clock::now()) {
+        Bucket &bucket = advance_to(now);
+        bucket.emit_opportunities++;
+        if (missed)
+            bucket.missed_emit_opportunities++;
+    }
+
+    /// @brief the missed emit percentage within the last `window`, which is rounded up to whole buckets
+    double get_missed_emit_percentage(std::chrono::milliseconds window, clock::time_point now = clock::now()) const {
+        int64_t current_bucket_number = get_bucket_number(now);
+        auto num_buckets_in_window = static_cast<int64_t>(
+            std::clamp<int64_t>((window + bucket_duration - std::chrono::milliseconds(1)) / bucket_duration, 1,
+                                num_buckets));
+
+        uint64_t opportunities = 0;
+        uint64_t missed = 0;
+        // a window reaching back before the counter existed starts at its first bucket
+        for (int64_t bucket_number = std::max<int64_t>(current_bucket_number - num_buckets_in_window + 1, 0);
+             bucket_number <= current_bucket_number; bucket_number++) {
+            // buckets older than the newest recorded one may be stale leftovers from a previous lap of the ring
+            if (bucket_number > newest_bucket_number or bucket_number <= newest_bucket_number - int64_t(num_buckets))
+                continue;
+            const Bucket &bucket = buckets[static_cast<size_t>(bucket_number) % num_buckets];
+            opportunities += bucket.emit_opportunities;
+            missed += bucket.missed_emit_opportunities;
+        }
+
+        return opportunities == 0 ? 0.0 : (double)missed * 100.0 / (double)opportunities;
+    }
+
+  private:
+    struct Bucket {
+        uint32_t emit_opportunities = 0;
+        uint32_t missed_emit_opportunities = 0;
+    };
+
+    int64_t get_bucket_number(clock::time_point now) const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time) / bucket_duration;
+    }
+
+    Bucket &advance_to(clock::time_point now) {
+        int64_t bucket_number = get_bucket_number(now);
+        if (bucket_number > newest_bucket_number) {
+            int64_t num_to_clear = std::min<int64_t>(bucket_number - newest_bucket_number, num_buckets);
+            for (int64_t i = 0; i < num_to_clear; i++) {
+                buckets[static_cast<size_t>(bucket_number - i) % num_buckets] = Bucket{};
             }
-            global_logger->debug("emitting now");
-            output_emitter.emit(emitted_value);
+            newest_bucket_number = bucket_number;
+        }
+        return buckets[static_cast<size_t>(newest_bucket_number) % num_buckets];
+    }
+
+    clock::time_point start_time = clock::now();
+    int64_t newest_bucket_number = 0;
+    std::array<Bucket, num_buckets> buckets{};
+};
+
+/**
+ * @brief Tracks the buffer depth over time: a time weighted exponential moving average plus the min and max within a
+ * recent window.
+ *
+ * Every call to `record` says "the depth is now this", the previous depth is weighted by how long it lasted. So as long
+ * as every change in depth is recorded the metrics mean the same thing whether `update` runs at 100hz or 1000hz,
+ * unlike an average over samples.
+ */
+class BufferDepthTracker {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds bucket_duration{250};
+    static constexpr size_t num_buckets = 40;
+    /// @brief the window `get_min` and `get_max` cover
+    static constexpr std::chrono::milliseconds min_max_window = bucket_duration * num_buckets;
+
+    /// @param time_constant how quickly the average follows the depth, after one time constant a step change in depth
+    /// is ~63% reflected
+    explicit BufferDepthTracker(std::chrono::duration<double> time_constant = std::chrono::seconds(1))
+        : time_constant_s(time_constant.count()) {}
+
+    void set_time_constant(std::chrono::duration<double> time_constant) { time_constant_s = time_constant.count(); }
+
+    void record(size_t depth, clock::time_point now = clock::now()) {
+        if (not has_samples) {
+            has_samples = true;
+            average = static_cast<double>(depth);
+            current_depth = depth;
         } else {
-            global_logger->debug("it's not time to emit a signal");
+            double elapsed_s = std::chrono::duration<double>(now - previous_sample_time).count();
+            if (elapsed_s > 0.0) {
+                double alpha = time_constant_s <= 0.0 ? 1.0 : 1.0 - std::exp(-elapsed_s / time_constant_s);
+                average += alpha * (static_cast<double>(current_depth) - average);
+            }
+        }
+
+        // the buckets skipped since the previous sample are seeded with the depth held until now, so this has to
+        // happen before the new depth replaces it
+        Bucket &bucket = advance_to(now);
+        current_depth = depth;
+        previous_sample_time = now;
+
+        bucket.min = std::min(bucket.min, depth);
+        bucket.max = std::max(bucket.max, depth);
+    }
+
+    /// @brief the time weighted average depth, 0 before anything has been recorded
+    double get_average() const { return average; }
+    size_t get_current() const { return current_depth; }
+
+    /// @brief the smallest depth within the last `min_max_window`
+    size_t get_min(clock::time_point now = clock::now()) const {
+        size_t min = current_depth;
+        for_each_bucket_in_window(now, [&](const Bucket &bucket) { min = std::min(min, bucket.min); });
+        return min;
+    }
+
+    /// @brief the largest depth within the last `min_max_window`
+    size_t get_max(clock::time_point now = clock::now()) const {
+        size_t max = current_depth;
+        for_each_bucket_in_window(now, [&](const Bucket &bucket) { max = std::max(max, bucket.max); });
+        return max;
+    }
+
+  private:
+    struct Bucket {
+        size_t min = std::numeric_limits<size_t>::max();
+        size_t max = 0;
+    };
+
+    int64_t get_bucket_number(clock::time_point now) const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time) / bucket_duration;
+    }
+
+    Bucket &advance_to(clock::time_point now) {
+        int64_t bucket_number = get_bucket_number(now);
+        if (bucket_number > newest_bucket_number) {
+            int64_t num_to_clear = std::min<int64_t>(bucket_number - newest_bucket_number, num_buckets);
+            for (int64_t i = 0; i < num_to_clear; i++) {
+                // a bucket starts out with the depth that was carried into it
+                buckets[static_cast<size_t>(bucket_number - i) % num_buckets] = Bucket{current_depth, current_depth};
+            }
+            newest_bucket_number = bucket_number;
+        }
+        return buckets[static_cast<size_t>(newest_bucket_number) % num_buckets];
+    }
+
+    template <typename Function> void for_each_bucket_in_window(clock::time_point now, Function function) const {
+        int64_t oldest_bucket_number = get_bucket_number(now) - static_cast<int64_t>(num_buckets) + 1;
+        for (int64_t bucket_number = std::max<int64_t>(oldest_bucket_number, 0); bucket_number <= newest_bucket_number;
+             bucket_number++) {
+            function(buckets[static_cast<size_t>(bucket_number) % num_buckets]);
+        }
+    }
+
+    double time_constant_s;
+
+    bool has_samples = false;
+    double average = 0.0;
+    size_t current_depth = 0;
+    clock::time_point previous_sample_time{};
+
+    clock::time_point start_time = clock::now();
+    int64_t newest_bucket_number = 0;
+    std::array<Bucket, num_buckets> buckets{};
+};
+
+/**
+ * @brief The buffer health logic shared by every quantizer variant, decides whether an emit opportunity can be used.
+ *
+ * Once the buffer runs dry we stop emitting and wait until `num_states_to_wait_for_after_empty` states have built up
+ * again, every opportunity spent waiting counts as a missed emit.
+ */
+class QuantizedEmitGate {
+  public:
+    enum class Decision {
+        emit,
+        miss,
+        /// @brief this opportunity was missed but the buffer has refilled, so emitting resumes on the next one
+        miss_refill_complete,
+    };
+
+    Decision on_emit_opportunity(size_t depth, unsigned int num_states_to_wait_for_after_empty) {
+        total_emit_opportunities++;
+
+        if (not repopulate_state_buffer and depth == 0) {
+            // only reachable if the buffer was emptied behind our back, treat it like running dry
+            repopulate_state_buffer = true;
+        }
+
+        recent_emit_opportunities.record(repopulate_state_buffer);
+
+        if (not repopulate_state_buffer)
+            return Decision::emit;
+
+        missed_emit_opportunities++;
+        if (depth >= num_states_to_wait_for_after_empty) {
+            repopulate_state_buffer = false;
+            return Decision::miss_refill_complete;
         }
+        return Decision::miss;
     }
 
+    /// @brief call after a state was taken out of the buffer because of an `emit` decision
+    void on_emitted(size_t depth_after_emit) { repopulate_state_buffer = depth_after_emit == 0; }
+
+    bool is_refilling() const { return repopulate_state_buffer; }
+
+    size_t get_total_emit_opportunities() const { return total_emit_opportunities; }
+    size_t get_missed_emit_opportunities() const { return missed_emit_opportunities; }
+
     double get_missed_emit_percentage() const {
         if (total_emit_opportunities == 0)
             return 0.0;
         return (double)missed_emit_opportunities * 100.0 / (double)total_emit_opportunities;
     }
 
-    double get_average_received_server_states_size() const { return average_received_server_states_size.get(); }
+    /// @brief the missed emit percentage over just the last `window`, at most `WindowedEmitCounter::max_window`
+    double get_missed_emit_percentage(std::chrono::milliseconds window) const {
+        return recent_emit_opportunities.get_missed_emit_percentage(window);
+    }
 
   private:
     bool repopulate_state_buffer = true;
     size_t total_emit_opportunities = 0;  // every time enough_time_has_passed()
     size_t missed_emit_opportunities = 0; // times we wanted to emit but couldn't
-
-    // For average deque size calculation
-    size_t running_total_deque_size = 0;
-    size_t running_deque_samples = 0;
+    WindowedEmitCounter recent_emit_opportunities;
 };
 
+/**
+ * @brief Keeps the statistics of many quantizers in one contiguous array so a monitor can aggregate the whole fleet in
+ * a single pass, instead of calling the getters of thousands of instances.
+ *
+ * Each registered quantizer owns a `Handle` to its slot and publishes into it with relaxed atomic stores after every
+ * emit opportunity, `collect` reads the slots concurrently. A snapshot is therefore not taken at one instant, but every
+ * individual value in it is one the quantizer actually published.
+ *
+ * The slots are shared between the registry and its handles, so a quantizer may outlive the registry it was
+ * registered with, it then keeps publishing into a slot nobody reads anymore.
+ */
+class QuantizerStatisticsRegistry {
+  private:
+    struct SlotStorage;
+
+  public:
+    struct alignas(64) Slot {
+        std::atomic<bool> in_use{false};
+        std::atomic<uint64_t> stream_id{0};
+        std::atomic<uint64_t> total_emit_opportunities{0};
+        std::atomic<uint64_t> missed_emit_opportunities{0};
+        std::atomic<uint64_t> buffered_state_count{0};
+    };
+
+    /**
+     * @brief an owning reference to a slot, releases it on destruction
+     * @note copying gives a detached handle, two handles publishing into the same slot would make its values
+     * meaningless, so a copied quantizer has to call `enable_fleet_statistics` itself to show up
+     */
+    class Handle {
+      public:
+        Handle() = default;
+        Handle(const Handle &) {}
+        Handle &operator=(const Handle &other) {
+            if (this != &other)
+                release();
+            return *this;
+        }
+        Handle(Handle &&other) noexcept
+            : storage(std::move(other.storage)), slot(std::exchange(other.slot, nullptr)) {}
+        Handle &operator=(Handle &&other) noexcept {
+            if (this != &other) {
+                release();
+                storage = std::move(other.storage);
+                slot = std::exchange(other.slot, nullptr);
+            }
+            return *this;
+        }
+        ~Handle() { release(); }
+
+        bool is_registered() const { return slot != nullptr; }
+
+        void publish(size_t total_emit_opportunities, size_t missed_emit_opportunities, size_t buffered_state_count) {
+            if (slot == nullptr)
+                return;
+            slot->total_emit_opportunities.store(total_emit_opportunities, std::memory_order_relaxed);
+            slot->missed_emit_opportunities.store(missed_emit_opportunities, std::memory_order_relaxed);
+            slot->buffered_state_count.store(buffered_state_count, std::memory_order_relaxed);
+        }
+
+      private:
+        friend class QuantizerStatisticsRegistry;
+        Handle(std::shared_ptr<SlotStorage> storage, Slot *slot) : storage(std::move(storage)), slot(slot) {}
+
+        void release() {
+            if (slot != nullptr)
+                storage->release_slot(slot);
+            storage.reset();
+            slot = nullptr;
+        }
+
+        // keeps the slot alive even if the registry is destroyed first
+        std::shared_ptr<SlotStorage> storage;
+        Slot *slot = nullptr;
+    };
+
+    /// @brief upper bounds of the missed emit percentage buckets, the last bucket takes everything above
+    static constexpr std::array<double, 7> missed_emit_percentage_bucket_bounds{0.1, 0.5, 1.0, 2.0, 5.0, 10.0, 25.0};
+
+    struct FleetStatistics {
+        size_t num_quantizers = 0;
+        double mean_missed_emit_percentage = 0.0;
+        double mean_buffered_state_count = 0.0;
+        size_t max_buffered_state_count = 0;
+        std::array<size_t, missed_emit_percentage_bucket_bounds.size() + 1> missed_emit_percentage_distribution{};
+        /// @brief (stream id, missed emit percentage) of the worst streams, worst first
+        std::vector<std::pair<uint64_t, double>> worst_streams;
+    };
+
+    explicit QuantizerStatisticsRegistry(size_t capacity = 8192) : storage(std::make_shared<SlotStorage>(capacity)) {}
+
+    QuantizerStatisticsRegistry(const QuantizerStatisticsRegistry &) = delete;
+    QuantizerStatisticsRegistry &operator=(const QuantizerStatisticsRegistry &) = delete;
+
+    /// @brief returns a detached handle if the registry is full
+    Handle register_quantizer(uint64_t stream_id) {
+        std::lock_guard<std::mutex> lock(storage->free_slots_mutex);
+        if (storage->free_slot_indices.empty())
+            return Handle();
+
+        Slot *slot = &storage->slots[storage->free_slot_indices.back()];
+        storage->free_slot_indices.pop_back();
+
+        slot->stream_id.store(stream_id, std::memory_order_relaxed);
+        slot->total_emit_opportunities.store(0, std::memory_order_relaxed);
+        slot->missed_emit_opportunities.store(0, std::memory_order_relaxed);
+        slot->buffered_state_count.store(0, std::memory_order_relaxed);
+        slot->in_use.store(true, std::memory_order_release);
+        return Handle(storage, slot);
+    }
+
+    /// @brief aggregates every registered quantizer in a single pass over the slots
+    FleetStatistics collect(size_t num_worst_streams = 10) const {
+        FleetStatistics statistics;
+        double sum_missed_emit_percentage = 0.0;
+        double sum_buffered_state_count = 0.0;
+
+        // min heap on the percentage so the least bad of the current worst streams is the one replaced
+        auto better_first = [](const auto &a, const auto &b) { return a.second > b.second; };
+        std::vector<std::pair<uint64_t, double>> &worst = statistics.worst_streams;
+        worst.reserve(num_worst_streams + 1);
+
+        for (size_t i = 0; i < storage->capacity; i++) {
+            const Slot &slot = storage->slots[i];
+            if (not slot.in_use.load(std::memory_order_acquire))
+                continue;
+
+            uint64_t total = slot.total_emit_opportunities.load(std::memory_order_relaxed);
+            uint64_t missed = slot.missed_emit_opportunities.load(std::memory_order_relaxed);
+            uint64_t depth = slot.buffered_state_count.load(std::memory_order_relaxed);
+            double missed_emit_percentage = total == 0 ? 0.0 : (double)missed * 100.0 / (double)total;
+
+            statistics.num_quantizers++;
+            sum_missed_emit_percentage += missed_emit_percentage;
+            sum_buffered_state_count += static_cast<double>(depth);
+            statistics.max_buffered_state_count = std::max(statistics.max_buffered_state_count, size_t(depth));
+
+            auto bucket = std::upper_bound(missed_emit_percentage_bucket_bounds.begin(),
+                                           missed_emit_percentage_bucket_bounds.end(), missed_emit_percentage);
+            statistics.missed_emit_percentage_distribution[bucket - missed_emit_percentage_bucket_bounds.begin()]++;
+
+            if (num_worst_streams != 0) {
+                worst.emplace_back(slot.stream_id.load(std::memory_order_relaxed), missed_emit_percentage);
+                std::push_heap(worst.begin(), worst.end(), better_first);
+                if (worst.size() > num_worst_streams) {
+                    std::pop_heap(worst.begin(), worst.end(), better_first);
+                    worst.pop_back();
+                }
+            }
+        }
+
+        std::sort_heap(worst.begin(), worst.end(), better_first);
+
+        if (statistics.num_quantizers != 0) {
+            statistics.mean_missed_emit_percentage = sum_missed_emit_percentage / statistics.num_quantizers;
+            statistics.mean_buffered_state_count = sum_buffered_state_count / statistics.num_quantizers;
+        }
+        return statistics;
+    }
+
+  private:
+    struct SlotStorage {
+        explicit SlotStorage(size_t capacity) : slots(std::make_unique<Slot[]>(capacity)), capacity(capacity) {
+            free_slot_indices.reserve(capacity);
+            for (size_t i = capacity; i > 0; i--)
+                free_slot_indices.push_back(i - 1);
+        }
+
+        void release_slot(Slot *slot) {
+            slot->in_use.store(false, std::memory_order_release);
+            std::lock_guard<std::mutex> lock(free_slots_mutex);
+            free_slot_indices.push_back(static_cast<size_t>(slot - slots.get()));
+        }
+
+        std::unique_ptr<Slot[]> slots;
+        size_t capacity;
+        std::mutex free_slots_mutex;
+        std::vector<size_t> free_slot_indices;
+    };
+
+    std::shared_ptr<SlotStorage> storage;
+};
+
+/**
+ * @brief Tracks the K streams with the highest score (e.g. miss rate or latency) as scores are reported, so the worst
+ * offenders out of thousands of streams can be queried at any time.
+ *
+ * Internally this is a min heap of at most K entries with an index from stream id to heap position, so reporting is
+ * O(log K) and a stream whose score isn't high enough to enter is rejected after one comparison.
+ *
+ * @note a stream that drops out of the top K is forgotten, if its score rises again it re-enters on its next report.
+ * When a stream goes away call `remove` so it doesn't linger at the top.
+ */
+class WorstStreamTracker {
+  public:
+    explicit WorstStreamTracker(size_t k = 10) : k(k) {
+        heap.reserve(k);
+        heap_position_of_stream.reserve(k);
+    }
+
+    void report(uint64_t stream_id, double score) {
+        std::lock_guard<std::mutex> lock(heap_mutex);
+
+        if (auto it = heap_position_of_stream.find(stream_id); it != heap_position_of_stream.end()) {
+            size_t position = it->second;
+            double previous_score = heap[position].second;
+            heap[position].second = score;
+            if (score < previous_score) {
+                sift_up(position);
+            } else {
+                sift_down(position);
+            }
+            return;
+        }
+
+        if (k == 0)
+            return;
+
+        if (heap.size() < k) {
+            heap.emplace_back(stream_id, score);
+            heap_position_of_stream[stream_id] = heap.size() - 1;
+            sift_up(heap.size() - 1);
+            return;
+        }
+
+        if (score <= heap.front().second)
+            return;
+
+        heap_position_of_stream.erase(heap.front().first);
+        heap.front() = {stream_id, score};
+        heap_position_of_stream[stream_id] = 0;
+        sift_down(0);
+    }
+
+    void remove(uint64_t stream_id) {
+        std::lock_guard<std::mutex> lock(heap_mutex);
+
+        auto it = heap_position_of_stream.find(stream_id);
+        if (it == heap_position_of_stream.end())
+            return;
+
+        size_t position = it->second;
+        heap_position_of_stream.erase(it);
+        if (position != heap.size() - 1) {
+            heap[position] = heap.back();
+            heap_position_of_stream[heap[position].first] = position;
+            heap.pop_back();
+            sift_up(position);
+            sift_down(position);
+        } else {
+            heap.pop_back();
+        }
+    }
+
+    /// @brief (stream id, score) of the tracked streams, worst first
+    std::vector<std::pair<uint64_t, double>> get_worst_streams() const {
+        std::vector<std::pair<uint64_t, double>> worst;
+        {
+            std::lock_guard<std::mutex> lock(heap_mutex);
+            worst = heap;
+        }
+        std::sort(worst.begin(), worst.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+        return worst;
+    }
+
+  private:
+    // NOTE: the sift functions are called with heap_mutex held, the root has the lowest score
+    void sift_up(size_t position) {
+        while (position > 0) {
+            size_t parent = (position - 1) / 2;
+            if (heap[parent].second <= heap[position].second)
+                break;
+            swap_entries(parent, position);
+            position = parent;
+        }
+    }
+
+    void sift_down(size_t position) {
+        while (true) {
+            size_t smallest = position;
+            size_t left = 2 * position + 1;
+            size_t right = left + 1;
+            if (left < heap.size() and heap[left].second < heap[smallest].second)
+                smallest = left;
+            if (right < heap.size() and heap[right].second < heap[smallest].second)
+                smallest = right;
+            if (smallest == position)
+                break;
+            swap_entries(smallest, position);
+            position = smallest;
+        }
+    }
+
+    void swap_entries(size_t a, size_t b) {
+        std::swap(heap[a], heap[b]);
+        heap_position_of_stream[heap[a].first] = a;
+        heap_position_of_stream[heap[b].first] = b;
+    }
+
+    size_t k;
+    mutable std::mutex heap_mutex;
+    std::vector<std::pair<uint64_t, double>> heap;
+    std::unordered_map<uint64_t, size_t> heap_position_of_stream;
+};
+
+/**
+ * @brief Which `WorstStreamTracker`s a quantizer reports into, either tracker may be left null.
+ */
+struct WorstStreamTracking {
+    WorstStreamTracker *by_missed_emit_percentage = nullptr;
+    /// @brief scored by the estimated buffering latency in milliseconds
+    WorstStreamTracker *by_latency = nullptr;
+    uint64_t stream_id = 0;
+};
+
+/**
+ * @brief Reports one stream's scores into the trackers of a `WorstStreamTracking`. Scores are recomputed at most once
+ * per `report_interval` and only reported when they moved, so an emit usually costs one time comparison instead of
+ * summing the miss rate window and taking the trackers' mutexes.
+ *
+ * @note like `QuantizerStatisticsRegistry::Handle` a copy is detached, otherwise two quantizers would report under the
+ * same stream id and overwrite each other's scores
+ */
+class WorstStreamReporter {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /// @brief the windowed miss rate only moves in steps of a bucket, recomputing it more often gains nothing
+    static constexpr std::chrono::milliseconds report_interval = WindowedEmitCounter::bucket_duration;
+    /// @brief a recomputed score that moved less than this since it was last reported isn't reported again
+    static constexpr double min_score_change = 0.01;
+
+    WorstStreamReporter() = default;
+    explicit WorstStreamReporter(WorstStreamTracking tracking) : tracking(tracking) {}
+    WorstStreamReporter(const WorstStreamReporter &) {}
+    WorstStreamReporter &operator=(const WorstStreamReporter &other) {
+        if (this != &other)
+            *this = WorstStreamReporter();
+        return *this;
+    }
+    WorstStreamReporter(WorstStreamReporter &&other) noexcept
+        : tracking(std::exchange(other.tracking, WorstStreamTracking{})), next_report_time(other.next_report_time),
+          last_reported_missed_emit_percentage(other.last_reported_missed_emit_percentage),
+          last_reported_latency_ms(other.last_reported_latency_ms) {}
+    WorstStreamReporter &operator=(WorstStreamReporter &&other) noexcept {
+        if (this != &other) {
+            tracking = std::exchange(other.tracking, WorstStreamTracking{});
+            next_report_time = other.next_report_time;
+            last_reported_missed_emit_percentage = other.last_reported_missed_emit_percentage;
+            last_reported_latency_ms = other.last_reported_latency_ms;
+        }
+        return *this;
+    }
+
+    const WorstStreamTracking &get_tracking() const { return tracking; }
+
+    /// @brief the scores are passed as callables so they're only computed when a report is due
+    template <typename GetMissedEmitPercentage, typename GetLatencyMs>
+    void maybe_report(GetMissedEmitPercentage get_missed_emit_percentage, GetLatencyMs get_latency_ms) {
+        if (tracking.by_missed_emit_percentage == nullptr and tracking.by_latency == nullptr)
+            return;
+
+        clock::time_point now = clock::now();
+        if (now < next_report_time)
+            return;
+        next_report_time = now + report_interval;
+
+        report_if_changed(tracking.by_missed_emit_percentage, get_missed_emit_percentage,
+                          last_reported_missed_emit_percentage);
+        report_if_changed(tracking.by_latency, get_latency_ms, last_reported_latency_ms);
+    }
+
+  private:
+    template <typename GetScore>
+    void report_if_changed(WorstStreamTracker *tracker, GetScore get_score,
+                           std::optional<double> &last_reported_score) {
+        if (tracker == nullptr)
+            return;
+        double score = get_score();
+        if (last_reported_score and std::abs(score - *last_reported_score) < min_score_change)
+            return;
+        tracker->report(tracking.stream_id, score);
+        last_reported_score = score;
+    }
+
+    WorstStreamTracking tracking;
+    clock::time_point next_report_time{};
+    std::optional<double> last_reported_missed_emit_percentage;
+    std::optional<double> last_reported_latency_ms;
+};
+
+/**
+ * @brief A compact summary of a client's buffer health, generated by the quantizer and sent back to the server.
+ *
+ * Serializes to a fixed little endian layout of `serialized_size` bytes so it can be piggybacked onto any packet.
+ */
+struct QuantizerHealthReport {
+    static constexpr size_t serialized_size = 16;
+
+    uint16_t buffered_state_count = 0;
+    /// @brief the smoothed buffer depth times 100
+    uint16_t average_buffered_state_count_centi = 0;
+    /// @brief total emit opportunities where nothing could be emitted
+    uint32_t underrun_count = 0;
+    /// @brief missed emit percentage over the last 10 seconds times 100
+    uint16_t missed_emit_basis_points = 0;
+    uint16_t reserved = 0;
+    /**
+     * @brief how much faster (positive) or slower (negative) states have recently been arriving than they are
+     * consumed, in parts per million, a persistent non zero value means the two clocks drift apart
+     */
+    int32_t drift_ppm = 0;
+
+    std::array<uint8_t, serialized_size> serialize() const {
+        std::array<uint8_t, serialized_size> bytes{};
+        size_t offset = 0;
+        auto write = [&](uint64_t value, size_t num_bytes) {
+            for (size_t i = 0; i < num_bytes; i++)
+                bytes[offset++] = static_cast<uint8_t>(value >> (8 * i));
+        };
+        write(buffered_state_count, 2);
+        write(average_buffered_state_count_centi, 2);
+        write(underrun_count, 4);
+        write(missed_emit_basis_points, 2);
+        write(reserved, 2);
+        write(static_cast<uint32_t>(drift_ppm), 4);
+        return bytes;
+    }
+
+    static QuantizerHealthReport deserialize(const std::array<uint8_t, serialized_size> &bytes) {
+        size_t offset = 0;
+        auto read = [&](size_t num_bytes) {
+            uint64_t value = 0;
+            for (size_t i = 0; i < num_bytes; i++)
+                value |= static_cast<uint64_t>(bytes[offset++]) << (8 * i);
+            return value;
+        };
+        QuantizerHealthReport report;
+        report.buffered_state_count = static_cast<uint16_t>(read(2));
+        report.average_buffered_state_count_centi = static_cast<uint16_t>(read(2));
+        report.underrun_count = static_cast<uint32_t>(read(4));
+        report.missed_emit_basis_points = static_cast<uint16_t>(read(2));
+        report.reserved = static_cast<uint16_t>(read(2));
+        report.drift_ppm = static_cast<int32_t>(static_cast<uint32_t>(read(4)));
+        return report;
+    }
+};
+
+/**
+ * @brief Server side consumer of `QuantizerHealthReport`s, turns each client's reports into a per client send
+ * adjustment so only the clients that struggle get extra redundancy.
+ *
+ * @tparam ClientId whatever the server uses to identify a client, must be hashable
+ */
+template <typename ClientId> class ClientBufferHealthMonitor {
+  public:
+    struct SendAdjustment {
+        /// @brief how many previous states to repeat in every packet sent to this client
+        unsigned int redundancy = 0;
+        /// @brief multiply the send rate for this client by this to counter its clock drift
+        double send_rate_scale = 1.0;
+    };
+
+    /// @brief above this missed emit percentage we add redundancy
+    double raise_redundancy_missed_emit_percentage = 2.0;
+    /// @brief below this missed emit percentage we take redundancy away again
+    double lower_redundancy_missed_emit_percentage = 0.25;
+    unsigned int max_redundancy = 4;
+    /// @brief the send rate is never adjusted further than this fraction
+    double max_send_rate_adjustment = 0.01;
+
+    void consume(const ClientId &client, const QuantizerHealthReport &report) {
+        ClientHealth &health = client_health[client];
+
+        // the report carries lifetime totals, so the miss rate since the previous report comes from the difference
+        uint32_t new_underruns =
+            report.underrun_count - std::min(report.underrun_count, health.last_report.underrun_count);
+        health.last_report = report;
+        health.has_report = true;
+
+        double missed_emit_percentage = report.missed_emit_basis_points / 100.0;
+        if (new_underruns > 0 and missed_emit_percentage > raise_redundancy_missed_emit_percentage) {
+            health.adjustment.redundancy = std::min(health.adjustment.redundancy + 1, max_redundancy);
+        } else if (new_underruns == 0 and missed_emit_percentage < lower_redundancy_missed_emit_percentage and
+                   health.adjustment.redundancy > 0) {
+            health.adjustment.redundancy--;
+        }
+
+        // a client that receives faster than it consumes builds up latency, so we send to it a little slower
+        double drift = static_cast<double>(report.drift_ppm) / 1'000'000.0;
+        health.adjustment.send_rate_scale =
+            std::clamp(1.0 / (1.0 + drift), 1.0 - max_send_rate_adjustment, 1.0 + max_send_rate_adjustment);
+    }
+
+    SendAdjustment get_send_adjustment(const ClientId &client) const {
+        auto it = client_health.find(client);
+        return it == client_health.end() ? SendAdjustment{} : it->second.adjustment;
+    }
+
+    std::optional<QuantizerHealthReport> get_last_report(const ClientId &client) const {
+        auto it = client_health.find(client);
+        if (it == client_health.end() or not it->second.has_report)
+            return std::nullopt;
+        return it->second.last_report;
+    }
+
+    void remove_client(const ClientId &client) { client_health.erase(client); }
+
+  private:
+    struct ClientHealth {
+        QuantizerHealthReport last_report;
+        bool has_report = false;
+        SendAdjustment adjustment;
+    };
+
+    std::unordered_map<ClientId, ClientHealth> client_health;
+};
+
+/**
+ * @brief A fixed rate tick clock that, unlike a plain "has a period passed" signal, reports how many ticks elapsed
+ * since it was last processed, so a caller that was stalled for a few periods can account for every one of them.
+ *
+ * Tick deadlines are kept on an absolute grid (next = previous + period) so they don't drift with the polling rate.
+ * `restart`, `process_and_get_signal` and `get_cycle_progess` behave like their `PeriodicSignal` counterparts, so code
+ * written against a quantizer's `PeriodicSignal` keeps working.
+ */
+class QuantizedTickClock {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    explicit QuantizedTickClock(double rate_hz) { set_rate(rate_hz); }
+
+    void set_rate(double rate_hz) {
+        this->rate_hz = rate_hz;
+        period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / rate_hz));
+    }
+
+    double get_rate_hz() const { return rate_hz; }
+    clock::duration get_period() const { return period; }
+
+    /// @brief the first tick happens one period from now
+    void restart(clock::time_point now = clock::now()) { next_tick_time = now + period; }
+
+    /// @brief the number of ticks whose deadline has passed since the last call, 0 if it isn't time yet
+    size_t process_and_get_elapsed_ticks(clock::time_point now = clock::now()) {
+        if (now < next_tick_time)
+            return 0;
+        auto num_elapsed_ticks = static_cast<size_t>((now - next_tick_time) / period) + 1;
+        next_tick_time += period * static_cast<int64_t>(num_elapsed_ticks);
+        return num_elapsed_ticks;
+    }
+
+    bool process_and_get_signal(clock::time_point now = clock::now()) {
+        return process_and_get_elapsed_ticks(now) != 0;
+    }
+
+    /// @brief moves every future tick by delta, negative means earlier
+    void shift_phase(clock::duration delta) { next_tick_time += delta; }
+
+    clock::time_point get_next_tick_time() const { return next_tick_time; }
+
+    /// @brief how far we are through the current period in [0, 1], useful for interpolating between emitted states
+    double get_cycle_progress(clock::time_point now = clock::now()) const {
+        double remaining = std::chrono::duration<double>(next_tick_time - now) / std::chrono::duration<double>(period);
+        return std::clamp(1.0 - remaining, 0.0, 1.0);
+    }
+
+    /**
+     * @brief where now falls on the tick grid in [0, 1), with ticks at 0, unlike `get_cycle_progress` this doesn't
+     * saturate when a deadline has passed but hasn't been processed yet
+     */
+    double get_phase(clock::time_point now = clock::now()) const {
+        double cycles = std::chrono::duration<double>(now - next_tick_time) / std::chrono::duration<double>(period);
+        return cycles - std::floor(cycles);
+    }
+
+    /// @brief same as `get_cycle_progress`, under the (misspelled) name `PeriodicSignal` uses
+    double get_cycle_progess(clock::time_point now = clock::now()) const { return get_cycle_progress(now); }
+
+  private:
+    double rate_hz = 60;
+    clock::duration period{};
+    clock::time_point next_tick_time{};
+};
+
+/**
+ * @brief What `update` does when more than one tick elapsed since it was last called, e.g. after a frame hitch.
+ */
+enum class QuantizerStallPolicy {
+    /// @brief every elapsed tick is handled as its own emit opportunity (bounded by `max_ticks_per_update`, past which
+    /// the states are skipped)
+    emit_every_tick,
+    /// @brief the elapsed ticks are collapsed into one emit of the newest due state, the states in between are skipped
+    /// and the count is available through `get_last_update_skipped_ticks`
+    emit_latest,
+};
+
+/**
+ * @brief Calls `process_emit_opportunity(num_ticks)` for the ticks that elapsed in one update as `policy` says, where
+ * `num_ticks` is how many ticks that opportunity stands for and so how many states it advances by.
+ *
+ * @return the number of elapsed ticks that didn't get an opportunity of their own
+ */
+template <typename ProcessEmitOpportunity>
+size_t handle_elapsed_ticks(size_t num_elapsed_ticks, QuantizerStallPolicy policy, size_t max_ticks_per_update,
+                            ProcessEmitOpportunity process_emit_opportunity) {
+    if (num_elapsed_ticks == 0)
+        return 0;
+
+    if (policy == QuantizerStallPolicy::emit_latest) {
+        process_emit_opportunity(num_elapsed_ticks);
+        return num_elapsed_ticks - 1;
+    }
+
+    size_t num_ticks_to_handle = std::min(num_elapsed_ticks, std::max<size_t>(max_ticks_per_update, 1));
+    size_t num_skipped_ticks = num_elapsed_ticks - num_ticks_to_handle;
+    for (size_t i = 0; i + 1 < num_ticks_to_handle; i++) {
+        process_emit_opportunity(1);
+    }
+    // the last opportunity also stands in for the ticks past the limit, so their states are skipped like with
+    // emit_latest instead of staying in the buffer as extra latency
+    process_emit_opportunity(1 + num_skipped_ticks);
+    return num_skipped_ticks;
+}
+
+/**
+ * @brief Settings for draining a backlog faster than one state per tick when far more states are buffered than needed.
+ */
+struct QuantizerCatchUp {
+    bool enabled = false;
+    /// @brief extra states are only emitted while more than this many are buffered
+    size_t target_depth = 4;
+    /// @brief bounds the work done per tick so catching up doesn't blow the frame time
+    size_t max_extra_states_per_tick = 2;
+    /**
+     * @brief when true the extra states of a tick are emitted together as one `QuantizedCatchUpBatch<T>`, otherwise
+     * each is emitted as another `std::optional<T>`
+     */
+    bool emit_as_batch = false;
+};
+
+/**
+ * @brief emitted after the regular state of a tick when catching up with `QuantizerCatchUp::emit_as_batch` set, the
+ * states are only valid during the emit
+ */
+template <typename T> struct QuantizedCatchUpBatch {
+    const T *states;
+    size_t num_states;
+};
+
+/**
+ * @brief Estimates where within the output cycle states typically arrive, and how much that phase jitters.
+ *
+ * Arrival phases are in [0, 1) cycles, they're averaged as unit vectors on a circle (so 0.95 and 0.05 average to 0
+ * rather than 0.5), with an exponential moving average so the estimate follows slow changes.
+ */
+class ArrivalPhaseEstimator {
+  public:
+    void record(double phase, double smoothing) {
+        double angle = 2.0 * pi * phase;
+        if (num_samples == 0) {
+            mean_cos = std::cos(angle);
+            mean_sin = std::sin(angle);
+        } else {
+            mean_cos += smoothing * (std::cos(angle) - mean_cos);
+            mean_sin += smoothing * (std::sin(angle) - mean_sin);
+        }
+        num_samples++;
+    }
+
+    /// @brief call when the output cycle itself moves by delta cycles, so the estimate stays relative to it
+    void rotate(double delta_cycles) {
+        double angle = 2.0 * pi * delta_cycles;
+        double rotated_cos = mean_cos * std::cos(angle) - mean_sin * std::sin(angle);
+        double rotated_sin = mean_cos * std::sin(angle) + mean_sin * std::cos(angle);
+        mean_cos = rotated_cos;
+        mean_sin = rotated_sin;
+    }
+
+    size_t get_sample_count() const { return num_samples; }
+
+    /// @brief the typical arrival phase in [0, 1)
+    double get_mean_phase() const {
+        double phase = std::atan2(mean_sin, mean_cos) / (2.0 * pi);
+        return phase < 0.0 ? phase + 1.0 : phase;
+    }
+
+    /// @brief circular standard deviation of the arrival phase, in cycles
+    double get_phase_stddev() const {
+        double resultant_length = std::clamp(std::sqrt(mean_cos * mean_cos + mean_sin * mean_sin), 1e-9, 1.0);
+        return std::sqrt(-2.0 * std::log(resultant_length)) / (2.0 * pi);
+    }
+
+  private:
+    static constexpr double pi = 3.14159265358979323846;
+
+    size_t num_samples = 0;
+    double mean_cos = 1.0;
+    double mean_sin = 0.0;
+};
+
+/**
+ * @brief Settings for sliding the emit phase to just after the typical arrival of states.
+ *
+ * The output signal starts on the first push, so its phase is whatever the jitter of that one packet happened to be,
+ * which can cost up to a full tick of latency. With this enabled the quantizer keeps measuring the arrival phase and
+ * slowly moves its ticks so they happen `margin` after the typical arrival, where margin covers the arrival jitter.
+ */
+struct QuantizerEmitPhaseAdaptation {
+    bool enabled = false;
+    /// @brief how many standard deviations of arrival phase jitter to leave between arrival and emit
+    double jitter_margin_stddevs = 2.0;
+    /// @brief an extra margin, as a fraction of the period, on top of the jitter margin
+    double fixed_margin_fraction = 0.05;
+    /// @brief the phase moves at most this fraction of a period per tick, so the shift is never noticeable
+    double max_shift_fraction_per_tick = 0.002;
+    /// @brief the smoothing factor of the arrival phase estimate
+    double arrival_phase_smoothing = 0.02;
+    /// @brief the phase isn't touched until this many arrivals have been measured
+    size_t min_arrivals_before_adapting = 30;
+};
+
+/**
+ * @brief Settings for emitting right before the display consumes the state at vsync.
+ *
+ * States emitted just after a vsync sit idle for almost a frame, so with this enabled and vsync times supplied through
+ * `set_upcoming_vsync` the ticks are slowly moved to land `emit_lead` before a vsync. This works best when the output
+ * rate divides the refresh rate. When `QuantizerEmitPhaseAdaptation` is enabled too, the first vsync after the
+ * typical arrival plus margin is chosen, so buffer health isn't traded for it.
+ */
+struct QuantizerVsyncAlignment {
+    bool enabled = false;
+    /// @brief how long before the vsync the state should be emitted, enough to cover the work done on it before present
+    std::chrono::microseconds emit_lead{1000};
+};
+
+/**
+ * @brief The default overflow policy, the oldest buffered states are dropped. That's fine for server states since
+ * newer ones supersede them.
+ *
+ * An overflow policy is consulted for every state the quantizer moves past without emitting it, which happens on
+ * overflow and when states are skipped by a playback speed above 1 or `QuantizerStallPolicy`.
+ */
+struct DropOldestOnOverflow {
+    template <typename T> static void on_overflow(const T & /*oldest*/, T & /*next*/) {}
+};
+
+/**
+ * @brief Overflow policy that coalesces a state that would be dropped or skipped into the next one, for streams where
+ * nothing may be lost such as client input commands.
+ *
+ * @tparam Merge a default constructible functor `void operator()(T &newer, const T &older) const` which folds the older
+ * state into the newer one, e.g. OR'ing button states and summing mouse deltas.
+ */
+template <typename Merge> struct MergeOnOverflow {
+    template <typename T> static void on_overflow(const T &oldest, T &next) { Merge{}(next, oldest); }
+};
+
+/**
+ * @brief A networked periodic signal quantizer for processing and emitting server states at a controlled rate.
+ *
+ * This templated class buffers states received from a server and emits them at a regular interval
+ * defined by an internal `QuantizedTickClock`. It is designed to take incoming server data that is being sent at a
+ * fixed rate, but due to network variance might not be received at a steady rate, and act as an adapter that takes this
+ * noisy signal and actually emits the data at a fixed frequency by buffering a few elements so there is always
+ * something to grab.
+ *
+ * @warn This does not solve the issue when the internet connection is lost for a few seconds or anything like that, as
+ * it only buffers a few elements, in such cases the buffer will be depleted and then the output emitter will output
+ * nullopt values in the output emitter
+ *
+ *
+ * @tparam T The type of the server state to be buffered and emitted.
+ * @tparam Hooks instrumentation policy called from `push` and `update`, see `NoQuantizerHooks`.
+ * @tparam OverflowPolicy what happens to states that are never emitted, either because more than
+ * `max_buffered_states` are buffered or because they are skipped, see `DropOldestOnOverflow` and `MergeOnOverflow`.
+ *
+ * @details
+ * The class maintains a deque of received states (`received_server_states`) and uses an `ArrivalIntervalStatistics`
+ * (`received_state_arrival_statistics`) to measure the actual arrival times of these states. It emits
+ * quantized output signals via a `SignalEmitter` (`output_emitter`) according to a `QuantizedTickClock`
+ * (`output_signal`). The class also tracks whether the buffer was empty on the previous update
+ * and tracks the buffer depth over time (`buffer_depth_tracker`) for monitoring purposes.
+ *
+ * Usage:
+ * - Call `push()` whenever a new server state arrives.
+ * - Call `update()` periodically to process and emit buffered states at the quantized rate.
+ * - Use `get_missed_emit_percentage()` and `get_average_received_server_states_size()` for metrics.
+ * - Set `retained_history_size` and use `get_state_at_tick()` to read back states that were already emitted.
+ *
+ * @note
+ * The first pushed state initializes the quantized signal timing.
+ */
+template <typename T, typename Hooks = NoQuantizerHooks, typename OverflowPolicy = DropOldestOnOverflow>
+class NetworkedPeriodicSignalQuantizer {
+  public:
+    explicit NetworkedPeriodicSignalQuantizer() {}
+
+    /**
+     * @brief the states that have been received, the first `retained_history_size` (at most) of them have already been
+     * emitted and are only kept around for `get_state_at_tick`, the rest are waiting to be emitted
+     */
+    std::deque<T> received_server_states;
+
+    /** @brief running statistics of the time between states received from the server, computed lazily on query */
+    ArrivalIntervalStatistics received_state_arrival_statistics;
+    /// @brief the recent rate states arrive at, which the drift in `generate_health_report` is derived from
+    ArrivalRateEstimator recent_arrival_rate;
+
+    /**
+     * @brief the clean smooth output signal that is used to drive the emitter
+     * @note you can use get_cycle_progress to see how close we are to the next signal, which can be used for
+     * interpolation purposess
+     */
+    QuantizedTickClock output_signal{60};
+    /// @brief the emitter which you should bind to receive the states
+    SignalEmitter output_emitter;
+
+    bool pushed_first_element = false;
+    bool logging_enabled = false;
+    /**
+     * @brief when logging is enabled, record the raw diagnostic arguments and let `DeferredDiagnosticsLogger` format
+     * them on its background thread instead of formatting synchronously in `push` and `update`, their log sections
+     * aren't opened either since those log synchronously too
+     */
+    bool deferred_logging_enabled = false;
+    /// @brief when enabled only anomalous or every nth update is recorded, see `QuantizerDiagnosticsSampling`
+    QuantizerDiagnosticsSampling diagnostics_sampling;
+
+    // NOTE: the higher this is the more delay there will be, but the lower the propbability you'll not have something
+    // to grab from the buffer
+    unsigned int num_states_to_wait_for_after_empty = 4;
+
+    /**
+     * @brief once more than this many states are buffered the oldest ones are dropped, 0 means unbounded
+     * @note never goes below `num_states_to_wait_for_after_empty`, otherwise the buffer could never refill
+     */
+    size_t max_buffered_states = 0;
+
+    /// @brief how ticks that elapsed while `update` wasn't being called are handled
+    QuantizerStallPolicy stall_policy = QuantizerStallPolicy::emit_every_tick;
+    /**
+     * @brief with `emit_every_tick` at most this many ticks are handled in a single update, the rest are skipped so a
+     * long stall doesn't turn into a flood of emits, the states they would have emitted are skipped along with them
+     */
+    size_t max_ticks_per_update = 8;
+
+    /// @brief emit more than one state per tick while the buffer holds a backlog, see `QuantizerCatchUp`
+    QuantizerCatchUp catch_up;
+
+    /// @brief slide the emit phase to just after the typical arrival, see `QuantizerEmitPhaseAdaptation`
+    QuantizerEmitPhaseAdaptation emit_phase_adaptation;
+    /// @brief where in the output cycle states arrive, only measured while `emit_phase_adaptation` is enabled
+    ArrivalPhaseEstimator arrival_phase_estimator;
+
+    /// @brief move emits to just before vsync, see `QuantizerVsyncAlignment` and `set_upcoming_vsync`
+    QuantizerVsyncAlignment vsync_alignment;
+
+    /**
+     * @brief how many already emitted states are kept behind the emit cursor so they can be read back with
+     * `get_state_at_tick`, e.g. for rollback re-simulation
+     */
+    size_t retained_history_size = 0;
+
+    /**
+     * @brief a `push_with_redundancy` sequence number this far behind the highest one so far is taken as the server
+     * restarting its numbering rather than as a very late packet, see `reset_sequence`
+     */
+    uint64_t sequence_reset_threshold = 1024;
+
+    /// @brief instrumentation hooks, with the default `NoQuantizerHooks` these cost nothing
+    [[no_unique_address]] Hooks hooks;
+
+    /// @brief time weighted average and recent min/max of the number of buffered states
+    BufferDepthTracker buffer_depth_tracker;
+
+    /**
+     * @brief Push a new state into the buffer.
+     */
+    void push(const T &item) {
+        GlobalLogSection _("npsq push", logging_enabled and not deferred_logging_enabled);
+
+        auto now = ArrivalIntervalStatistics::clock::now();
+        received_state_arrival_statistics.record_arrival(now);
+        recent_arrival_rate.record_arrival(now);
+        buffer_state(item);
+        record_arrival_phase();
+    }
+
+    /**
+     * @brief Push a packet that carries the state with the given sequence number along with the K states before it, as
+     * sent by a server using redundant encoding.
+     *
+     * States we've already buffered are ignored and any gap since the last packet is filled from the redundant states
+     * where possible, so each sequence number is buffered at most once and a single lost packet doesn't cost an emit.
+     * A state that is still missing when a later packet arrives is inserted in its place if it turns up afterwards,
+     * directly or as a redundant state, as long as the states after it haven't been emitted yet.
+     *
+     * @note don't mix this with `push` on the same quantizer, the sequence numbers have to account for every state
+     *
+     * @param redundant_previous_states the states for sequence - 1, sequence - 2, ... in that order
+     * @param num_redundant_previous_states how many states `redundant_previous_states` points to
+     */
+    void push_with_redundancy(uint64_t sequence, const T &item, const T *redundant_previous_states = nullptr,
+                              size_t num_redundant_previous_states = 0) {
+        GlobalLogSection _("npsq push", logging_enabled and not deferred_logging_enabled);
+
+        if (pushed_any_sequence and sequence + sequence_reset_threshold < highest_pushed_sequence) {
+            log_diagnostic(
+                [](const DeferredDiagnosticRecord &r) {
+                    global_logger->debug("sequence went back from {} to {}, the server restarted its numbering",
+                                         r.arguments[0], r.arguments[1]);
+                },
+                highest_pushed_sequence, sequence);
+            reset_sequence();
+        }
+
+        if (pushed_any_sequence and sequence <= highest_pushed_sequence) {
+            insert_late_state(sequence, item);
+            return;
+        }
+
+        // late and duplicate states say nothing about when the stream's states arrive, so only states that advance the
+        // sequence are recorded, and the sequence numbers tell us how many states the server sent since the last
+        // packet, lost ones included
+        auto now = ArrivalIntervalStatistics::clock::now();
+        received_state_arrival_statistics.record_arrival(now);
+        recent_arrival_rate.record_arrival(now, pushed_any_sequence ? sequence - highest_pushed_sequence : 1);
+
+        if (pushed_any_sequence) {
+            uint64_t num_redundant_states = std::min<uint64_t>(sequence, num_redundant_previous_states);
+            uint64_t oldest_redundant_sequence = sequence - num_redundant_states;
+
+            // gaps left by earlier packets, newest first since once one is behind the emit cursor so are the older ones
+            for (size_t i = missing_sequences.size(); i > 0 and missing_sequences[i - 1] >= oldest_redundant_sequence;
+                 i--) {
+                uint64_t missing_sequence = missing_sequences[i - 1];
+                const T &redundant_state =
+                    redundant_previous_states[static_cast<size_t>(sequence - 1 - missing_sequence)];
+                if (not try_insert_missing_state(missing_sequence, redundant_state))
+                    break;
+                states_recovered_from_redundancy++;
+            }
+
+            // anything before the first packet we saw is older than what we started emitting from, so only fill gaps,
+            // and only the tail of a gap can be recovered so we don't walk the whole gap after a long outage
+            uint64_t first_missing_sequence = highest_pushed_sequence + 1;
+            uint64_t first_recoverable_sequence = std::max(first_missing_sequence, oldest_redundant_sequence);
+            uint64_t num_lost_states = first_recoverable_sequence - first_missing_sequence;
+            states_lost += static_cast<size_t>(num_lost_states);
+
+            // the lost states may still turn up later, only the newest ones can be inserted by then anyway
+            for (uint64_t missing_sequence =
+                     first_recoverable_sequence - std::min<uint64_t>(num_lost_states, max_tracked_missing_sequences);
+                 missing_sequence < first_recoverable_sequence; missing_sequence++) {
+                missing_sequences.push_back(missing_sequence);
+            }
+            while (missing_sequences.size() > max_tracked_missing_sequences)
+                missing_sequences.pop_front();
+
+            for (uint64_t missing_sequence = first_recoverable_sequence; missing_sequence < sequence;
+                 missing_sequence++) {
+                buffer_state(redundant_previous_states[static_cast<size_t>(sequence - 1 - missing_sequence)]);
+                states_recovered_from_redundancy++;
+            }
+        }
+
+        buffer_state(item);
+        record_arrival_phase();
+        highest_pushed_sequence = sequence;
+        pushed_any_sequence = true;
+    }
+
+    /**
+     * @brief forget the sequence numbering so the next `push_with_redundancy` starts a new one, e.g. after the server
+     * restarted, the buffered states are kept. Happens on its own when the sequence goes back by more than
+     * `sequence_reset_threshold`.
+     */
+    void reset_sequence() {
+        pushed_any_sequence = false;
+        highest_pushed_sequence = 0;
+        missing_sequences.clear();
+    }
+
+    size_t get_states_recovered_from_redundancy() const { return states_recovered_from_redundancy; }
+    /// @brief sequence numbers that never arrived, neither directly nor through redundancy, or arrived too late
+    size_t get_states_lost() const { return states_lost; }
+    size_t get_duplicate_states_ignored() const { return duplicate_states_ignored; }
+    /// @brief states that were missing and arrived after the states following them had already been emitted
+    size_t get_late_states_dropped() const { return late_states_dropped; }
+
+    /**
+     * @brief Call periodically to emit states at the proper rate.
+     */
+    void update() {
+        GlobalLogSection _("npsq update", logging_enabled and not deferred_logging_enabled);
+
+        last_update_emit_time.reset();
+        begin_diagnostics_sample(get_buffered_state_count(), true);
+
+        log_diagnostic(
+            [](const DeferredDiagnosticRecord &r) { global_logger->debug("size is now: {}", r.arguments[0]); },
+            get_buffered_state_count());
+
+        if (not pushed_first_element)
+            return;
+
+        size_t num_elapsed_ticks = output_signal.process_and_get_elapsed_ticks();
+        if (num_elapsed_ticks == 0) {
+            log_diagnostic(
+                [](const DeferredDiagnosticRecord &) { global_logger->debug("it's not time to emit a signal"); });
+            return;
+        }
+
+        if (num_elapsed_ticks > 1) {
+            log_diagnostic(
+                [](const DeferredDiagnosticRecord &r) {
+                    global_logger->debug("{} ticks elapsed since the last update", r.arguments[0]);
+                },
+                num_elapsed_ticks);
+        }
+
+        last_update_skipped_ticks =
+            handle_elapsed_ticks(num_elapsed_ticks, stall_policy, max_ticks_per_update,
+                                 [this](size_t num_ticks) { process_emit_opportunity(num_ticks); });
+
+        adapt_emit_phase(num_elapsed_ticks);
+    }
+
+    /**
+     * @brief tell the quantizer when the next vsync happens and the refresh period, call this every frame (or
+     * whenever the display timing is known to change), later vsyncs are extrapolated from it
+     */
+    void set_upcoming_vsync(QuantizedTickClock::clock::time_point next_vsync_time,
+                            QuantizedTickClock::clock::duration vsync_period) {
+        upcoming_vsync_time = next_vsync_time;
+        upcoming_vsync_period = vsync_period;
+    }
+
+    /**
+     * @brief the cycle progress at the moment the upcoming vsync is displayed rather than right now, which is the
+     * point you want to interpolate the emitted states to, falls back to the current progress without vsync timing
+     */
+    double get_cycle_progress_at_upcoming_vsync() const {
+        if (upcoming_vsync_period <= QuantizedTickClock::clock::duration::zero())
+            return output_signal.get_cycle_progress();
+        return output_signal.get_cycle_progress(upcoming_vsync_time);
+    }
+
+    /// @brief how many elapsed ticks the last update didn't emit for on their own, see `QuantizerStallPolicy`
+    size_t get_last_update_skipped_ticks() const { return last_update_skipped_ticks; }
+
+    /// @brief when the last update emitted its first value (a state or nullopt), nullopt if it didn't emit at all
+    std::optional<QuantizedTickClock::clock::time_point> get_last_update_emit_time() const {
+        return last_update_emit_time;
+    }
+
+    double get_missed_emit_percentage() const { return emit_gate.get_missed_emit_percentage(); }
+
+    /// @brief the missed emit percentage over the last `window` only, e.g. 1s, 10s or 60s
+    double get_missed_emit_percentage(std::chrono::milliseconds window) const {
+        return emit_gate.get_missed_emit_percentage(window);
+    }
+
+    /// @brief the window used whenever the quantizer reports its current miss rate to something else
+    static constexpr std::chrono::seconds recent_miss_rate_window{10};
+
+    /**
+     * @brief publishes this quantizer's statistics into the registry from now on, so it shows up in
+     * `QuantizerStatisticsRegistry::collect`
+     * @note copies of this quantizer aren't registered, and since a `std::vector` copies its elements when it grows
+     * (the move constructor isn't noexcept), register quantizers once they're in storage that doesn't relocate them
+     */
+    void enable_fleet_statistics(QuantizerStatisticsRegistry &registry, uint64_t stream_id) {
+        fleet_statistics = registry.register_quantizer(stream_id);
+    }
+
+    /**
+     * @brief reports this quantizer's recent miss rate and buffering latency into the given trackers from now on, see
+     * `WorstStreamReporter` for how often
+     * @note copies of this quantizer don't report, same as with `enable_fleet_statistics`
+     */
+    void enable_worst_stream_tracking(WorstStreamTracking tracking) {
+        worst_stream_reporter = WorstStreamReporter(tracking);
+    }
+
+    /**
+     * @brief summarizes the buffer health so it can be sent back to the server, see `ClientBufferHealthMonitor`
+     */
+    QuantizerHealthReport generate_health_report() const {
+        auto saturate_u16 = [](double value) {
+            return static_cast<uint16_t>(std::clamp(value, 0.0, static_cast<double>(UINT16_MAX)));
+        };
+
+        QuantizerHealthReport report;
+        report.buffered_state_count = saturate_u16(static_cast<double>(get_buffered_state_count()));
+        report.average_buffered_state_count_centi = saturate_u16(get_average_received_server_states_size() * 100.0);
+        report.underrun_count = static_cast<uint32_t>(emit_gate.get_missed_emit_opportunities());
+        report.missed_emit_basis_points = saturate_u16(get_missed_emit_percentage(recent_miss_rate_window) * 100.0);
+
+        // the recent arrival rate against the rate we consume at, neither the prefill, overflow drops nor (for
+        // sequenced pushes) packet loss skew this, and it follows the drift as it changes
+        double arrival_rate_hz = recent_arrival_rate.get_rate_hz();
+        double consume_rate_hz = output_signal.get_rate_hz() * playback_speed;
+        if (arrival_rate_hz > 0.0 and consume_rate_hz > 0.0) {
+            double rate_ratio = arrival_rate_hz / consume_rate_hz;
+            report.drift_ppm = static_cast<int32_t>(std::clamp((rate_ratio - 1.0) * 1'000'000.0, -1e9, 1e9));
+        }
+        return report;
+    }
+
+    /**
+     * @brief scales the emit rate without touching the output signal, 0.5 emits on every other signal, 2 skips every
+     * other state and 0 pauses
+     */
+    void set_playback_speed(double speed) { playback_speed = std::max(0.0, speed); }
+    double get_playback_speed() const { return playback_speed; }
+
+    /**
+     * @brief how long a state that arrives now waits before it's emitted, the buffered states times the mean time
+     * between arrivals (which matches the server's send period)
+     */
+    double get_estimated_buffering_latency_ms() const {
+        return static_cast<double>(get_buffered_state_count()) *
+               received_state_arrival_statistics.get_mean_interval_us() / 1000.0;
+    }
+
+    /// @brief the number of states waiting to be emitted, this excludes the retained history
+    size_t get_buffered_state_count() const { return received_server_states.size() - num_retained_states; }
+
+    /**
+     * @brief O(1) access to a retained or buffered state, ticks count every state ever pushed starting at 0
+     * @return nullptr if that state has already been discarded or hasn't been received yet
+     */
+    const T *get_state_at_tick(uint64_t tick) const {
+        if (tick < first_stored_tick or tick - first_stored_tick >= received_server_states.size())
+            return nullptr;
+        return &received_server_states[static_cast<size_t>(tick - first_stored_tick)];
+    }
+
+    /// @brief the tick of the next state that will be emitted
+    uint64_t get_next_emit_tick() const { return first_stored_tick + num_retained_states; }
+
+    /// @brief the oldest tick `get_state_at_tick` can still return
+    uint64_t get_oldest_stored_tick() const { return first_stored_tick; }
+
+    double get_average_received_server_states_size() const { return buffer_depth_tracker.get_average(); }
+
+  private:
+    void record_arrival_phase() {
+        if (not emit_phase_adaptation.enabled)
+            return;
+        // measured on the tick grid itself, arrivals between a passed deadline and the next update would otherwise all
+        // be recorded at the saturated progress of 1
+        arrival_phase_estimator.record(output_signal.get_phase(), emit_phase_adaptation.arrival_phase_smoothing);
+    }
+
+    /**
+     * @brief nudges the tick grid towards emitting `margin` after the typical arrival and/or just before a vsync,
+     * bounded by the per tick limit
+     */
+    void adapt_emit_phase(size_t num_elapsed_ticks) {
+        using clock = QuantizedTickClock::clock;
+
+        auto period = std::chrono::duration<double>(output_signal.get_period());
+        clock::time_point next_tick_time = output_signal.get_next_tick_time();
+
+        bool adapting_to_arrivals =
+            emit_phase_adaptation.enabled and
+            arrival_phase_estimator.get_sample_count() >= emit_phase_adaptation.min_arrivals_before_adapting;
+        bool aligning_to_vsync = vsync_alignment.enabled and upcoming_vsync_period > clock::duration::zero();
+
+        if (not adapting_to_arrivals and not aligning_to_vsync)
+            return;
+
+        // how many cycles too late our ticks currently are
+        double excess_delay = 0.0;
+
+        if (adapting_to_arrivals) {
+            double margin = std::clamp(emit_phase_adaptation.fixed_margin_fraction +
+                                           emit_phase_adaptation.jitter_margin_stddevs *
+                                               arrival_phase_estimator.get_phase_stddev(),
+                                       0.0, 0.95);
+            // the next tick happens at phase 1, we want it at the typical arrival plus margin
+            excess_delay = 1.0 - arrival_phase_estimator.get_mean_phase() - margin;
+            excess_delay -= std::floor(excess_delay + 0.5);
+        }
+
+        if (aligning_to_vsync) {
+            auto desired_tick_time =
+                next_tick_time - std::chrono::duration_cast<clock::duration>(excess_delay * period);
+            auto emit_point = get_vsync_emit_point(desired_tick_time, adapting_to_arrivals);
+            excess_delay = std::chrono::duration<double>(next_tick_time - emit_point) / period;
+        }
+
+        excess_delay -= std::floor(excess_delay + 0.5);
+
+        double max_shift = emit_phase_adaptation.max_shift_fraction_per_tick * static_cast<double>(num_elapsed_ticks);
+        double shift = std::clamp(excess_delay, -max_shift, max_shift);
+        if (shift == 0.0)
+            return;
+
+        output_signal.shift_phase(-std::chrono::duration_cast<clock::duration>(shift * period));
+        // moving the ticks earlier makes the same arrivals land later in the cycle
+        arrival_phase_estimator.rotate(shift);
+    }
+
+    /**
+     * @brief the point `vsync_alignment.emit_lead` before a vsync which is closest to time_point, or the first one
+     * at or after it when we can't emit any earlier than that
+     */
+    QuantizedTickClock::clock::time_point get_vsync_emit_point(QuantizedTickClock::clock::time_point time_point,
+                                                              bool not_before_time_point) const {
+        auto first_emit_point = upcoming_vsync_time - vsync_alignment.emit_lead;
+        double vsyncs_from_first = std::chrono::duration<double>(time_point - first_emit_point) /
+                                   std::chrono::duration<double>(upcoming_vsync_period);
+        double k = not_before_time_point ? std::ceil(vsyncs_from_first) : std::round(vsyncs_from_first);
+        return first_emit_point + upcoming_vsync_period * static_cast<int64_t>(k);
+    }
+
+    /**
+     * @brief handles one emit opportunity that stands in for num_ticks output ticks, more than one tick means the
+     * intermediate states are skipped rather than emitted
+     */
+    void process_emit_opportunity(size_t num_ticks) {
+        playback_credit += playback_speed * static_cast<double>(num_ticks);
+        auto num_states_to_advance = static_cast<size_t>(playback_credit);
+        if (num_states_to_advance == 0) {
+            log_diagnostic([](const DeferredDiagnosticRecord &) {
+                global_logger->debug("playback is paused or slowed down, holding on this signal");
+            });
+            return;
+        }
+        playback_credit -= static_cast<double>(num_states_to_advance);
+
+        log_diagnostic([](const DeferredDiagnosticRecord &) { global_logger->debug("its time to emit a signal"); });
+        std::optional<T> emitted_value = std::nullopt;
+
+        auto decision = emit_gate.on_emit_opportunity(get_buffered_state_count(), num_states_to_wait_for_after_empty);
+
+        if (decision != QuantizedEmitGate::Decision::emit) {
+            if (diagnostics_sampling.record_missed_emits)
+                current_update_sampled = true;
+
+            log_diagnostic(
+                [](const DeferredDiagnosticRecord &r) {
+                    global_logger->debug(
+                        "would've emitted a signal but we are waiting for {} states in the buffer before we "
+                        "get started emitting again, there are currently {}",
+                        r.arguments[0], r.arguments[1]);
+                },
+                num_states_to_wait_for_after_empty, get_buffered_state_count());
+
+            hooks.on_miss(get_buffered_state_count());
+
+            if (decision == QuantizedEmitGate::Decision::miss_refill_complete) {
+                hooks.on_refill_complete(get_buffered_state_count());
+            }
+        } else {
+            // when playing back faster than real time or catching up after a stall, the intermediate states are
+            // skipped, not emitted
+            skip_states(std::min(num_states_to_advance, get_buffered_state_count()) - 1);
+            emitted_value = take_next_state();
+            log_diagnostic(
+                [](const DeferredDiagnosticRecord &r) {
+                    global_logger->debug("just popped, size is now: {}", r.arguments[0]);
+                },
+                get_buffered_state_count());
+            emit_gate.on_emitted(get_buffered_state_count());
+            hooks.on_emit(get_buffered_state_count());
+        }
+
+        fleet_statistics.publish(emit_gate.get_total_emit_opportunities(), emit_gate.get_missed_emit_opportunities(),
+                                 get_buffered_state_count());
+        report_to_worst_stream_trackers();
+        buffer_depth_tracker.record(get_buffered_state_count());
+
+        if (emitted_value == std::nullopt) {
+            log_diagnostic([](const DeferredDiagnosticRecord &) { global_logger->debug("emitting empty"); });
+        } else {
+            log_diagnostic([](const DeferredDiagnosticRecord &) { global_logger->debug("emitting value now"); });
+        }
+        log_diagnostic([](const DeferredDiagnosticRecord &) { global_logger->debug("emitting now"); });
+        if (not last_update_emit_time)
+            last_update_emit_time = QuantizedTickClock::clock::now();
+        output_emitter.emit(emitted_value);
+
+        if (emitted_value != std::nullopt)
+            emit_catch_up_states();
+    }
+
+    void emit_catch_up_states() {
+        if (not catch_up.enabled or get_buffered_state_count() <= catch_up.target_depth)
+            return;
+
+        size_t num_extra_states =
+            std::min(get_buffered_state_count() - catch_up.target_depth, catch_up.max_extra_states_per_tick);
+
+        log_diagnostic(
+            [](const DeferredDiagnosticRecord &r) {
+                global_logger->debug("catching up, emitting {} extra states this tick", r.arguments[0]);
+            },
+            num_extra_states);
+
+        if (catch_up.emit_as_batch) {
+            catch_up_batch.clear();
+            for (size_t i = 0; i < num_extra_states; i++) {
+                catch_up_batch.push_back(take_next_state());
+                hooks.on_emit(get_buffered_state_count());
+            }
+            output_emitter.emit(QuantizedCatchUpBatch<T>{catch_up_batch.data(), catch_up_batch.size()});
+        } else {
+            for (size_t i = 0; i < num_extra_states; i++) {
+                std::optional<T> extra_value = take_next_state();
+                hooks.on_emit(get_buffered_state_count());
+                output_emitter.emit(extra_value);
+            }
+        }
+
+        buffer_depth_tracker.record(get_buffered_state_count());
+    }
+
+    void report_to_worst_stream_trackers() {
+        worst_stream_reporter.maybe_report([this] { return get_missed_emit_percentage(recent_miss_rate_window); },
+                                           [this] { return get_estimated_buffering_latency_ms(); });
+    }
+
+    // a state at or below highest_pushed_sequence, either one that went missing or a duplicate
+    void insert_late_state(uint64_t sequence, const T &item) {
+        if (not std::binary_search(missing_sequences.begin(), missing_sequences.end(), sequence)) {
+            duplicate_states_ignored++;
+            log_diagnostic(
+                [](const DeferredDiagnosticRecord &r) {
+                    global_logger->debug("ignoring state {}, we already have up to {}", r.arguments[0], r.arguments[1]);
+                },
+                sequence, highest_pushed_sequence);
+            return;
+        }
+
+        if (not try_insert_missing_state(sequence, item)) {
+            log_diagnostic(
+                [](const DeferredDiagnosticRecord &r) {
+                    global_logger->debug("state {} arrived after the states following it were emitted", r.arguments[0]);
+                },
+                sequence);
+        }
+    }
+
+    /**
+     * @brief puts a state from `missing_sequences` in its place among the buffered states, fails if the states after it
+     * were already emitted, in which case it and every older missing sequence is given up on
+     */
+    bool try_insert_missing_state(uint64_t sequence, const T &item) {
+        auto missing = std::lower_bound(missing_sequences.begin(), missing_sequences.end(), sequence);
+        // every sequence after this one is buffered except the newer missing ones, all of which are tracked since
+        // missing_sequences only ever forgets the oldest
+        auto num_newer_missing = static_cast<uint64_t>(missing_sequences.end() - missing - 1);
+        uint64_t num_newer_states = highest_pushed_sequence - sequence - num_newer_missing;
+
+        if (num_newer_states > get_buffered_state_count()) {
+            missing_sequences.erase(missing_sequences.begin(), missing + 1);
+            late_states_dropped++;
+            return false;
+        }
+
+        missing_sequences.erase(missing);
+        states_lost--;
+        buffer_state(item, static_cast<size_t>(num_newer_states));
+        return true;
+    }
+
+    /// @param num_newer_states how many of the buffered states belong after this one, 0 appends it
+    void buffer_state(const T &item, size_t num_newer_states = 0) {
+        if (num_newer_states == 0) {
+            received_server_states.push_back(item);
+        } else {
+            received_server_states.insert(received_server_states.end() - static_cast<std::ptrdiff_t>(num_newer_states),
+                                          item);
+        }
+        hooks.on_push(get_buffered_state_count());
+
+        size_t max_states = get_effective_max_buffered_states();
+        size_t num_to_drop = 0;
+        if (max_states != 0 and get_buffered_state_count() > max_states) {
+            num_to_drop = get_buffered_state_count() - max_states;
+            // dropped states are treated as consumed without being emitted, that way ticks stay contiguous
+            skip_states(num_to_drop);
+        }
+
+        // the sampling decision has to be made before anything about this push is logged
+        begin_diagnostics_sample(get_buffered_state_count(), false);
+        buffer_depth_tracker.record(get_buffered_state_count());
+
+        if (num_to_drop != 0) {
+            hooks.on_overflow(get_buffered_state_count(), num_to_drop);
+            log_diagnostic(
+                [](const DeferredDiagnosticRecord &r) {
+                    global_logger->debug("buffer overflowed, dropped or merged the {} oldest states", r.arguments[0]);
+                },
+                num_to_drop);
+        }
+
+        if (not pushed_first_element) {
+            pushed_first_element = true;
+            output_signal.restart();
+        }
+
+        log_diagnostic(
+            [](const DeferredDiagnosticRecord &r) { global_logger->debug("size is now: {}", r.arguments[0]); },
+            get_buffered_state_count());
+
+        // TODO: adjust the quantlized output signal to match the server micro mean period
+    }
+
+    /// @brief `max_buffered_states` raised to the refill threshold, so a full buffer can always restart emitting
+    size_t get_effective_max_buffered_states() const {
+        if (max_buffered_states == 0)
+            return 0;
+        return std::max<size_t>(max_buffered_states, num_states_to_wait_for_after_empty);
+    }
+
+    /**
+     * @brief moves the emit cursor past the next state, which stays in the buffer as history if we're retaining any
+     */
+    T take_next_state() {
+        if (retained_history_size == 0 and num_retained_states == 0) {
+            T state = std::move(received_server_states.front());
+            received_server_states.pop_front();
+            first_stored_tick++;
+            return state;
+        }
+
+        T state = received_server_states[num_retained_states];
+        num_retained_states++;
+        trim_retained_history();
+        return state;
+    }
+
+    /**
+     * @brief moves the emit cursor past the next num_states without emitting them, the overflow policy gets a chance to
+     * fold each one into the state after it first
+     * @note at least one state must remain buffered after the skipped ones
+     */
+    void skip_states(size_t num_states) {
+        for (size_t i = 0; i < num_states; i++) {
+            OverflowPolicy::on_overflow(received_server_states[num_retained_states],
+                                        received_server_states[num_retained_states + 1]);
+            num_retained_states++;
+        }
+        trim_retained_history();
+    }
+
+    void trim_retained_history() {
+        while (num_retained_states > retained_history_size) {
+            received_server_states.pop_front();
+            num_retained_states--;
+            first_stored_tick++;
+        }
+    }
+
+    /**
+     * @brief formats the diagnostic right away, or hands the raw arguments to the deferred logger when
+     * `deferred_logging_enabled` is set
+     */
+    template <typename... Args> void log_diagnostic(DeferredDiagnosticRecord::Formatter formatter, Args... args) {
+        static_assert(sizeof...(Args) <= DeferredDiagnosticRecord::max_arguments);
+
+        if (not logging_enabled or (diagnostics_sampling.enabled and not current_update_sampled))
+            return;
+
+        DeferredDiagnosticRecord record{formatter, {static_cast<size_t>(args)...}};
+        if (deferred_logging_enabled) {
+            DeferredDiagnosticsLogger::get().record(record);
+        } else {
+            formatter(record);
+        }
+    }
+
+    /**
+     * @brief decides whether the diagnostics of the current push or update should be recorded under the sampling
+     * rules, a miss later on in the update can still turn recording on
+     */
+    void begin_diagnostics_sample(size_t depth, bool is_update) {
+        if (not logging_enabled or not diagnostics_sampling.enabled)
+            return;
+
+        DepthBand band = DepthBand::normal;
+        if (depth <= diagnostics_sampling.low_depth_threshold) {
+            band = DepthBand::low;
+        } else if (depth >= diagnostics_sampling.high_depth_threshold) {
+            band = DepthBand::high;
+        }
+
+        current_update_sampled = band != previous_depth_band;
+        previous_depth_band = band;
+
+        if (is_update and diagnostics_sampling.every_nth_update != 0) {
+            updates_since_last_sample++;
+            if (updates_since_last_sample >= diagnostics_sampling.every_nth_update) {
+                updates_since_last_sample = 0;
+                current_update_sampled = true;
+            }
+        }
+    }
+
+    enum class DepthBand { low, normal, high };
+    DepthBand previous_depth_band = DepthBand::low;
+    bool current_update_sampled = false;
+    unsigned int updates_since_last_sample = 0;
+
+    QuantizedEmitGate emit_gate;
+    QuantizerStatisticsRegistry::Handle fleet_statistics;
+    WorstStreamReporter worst_stream_reporter;
+
+    // the states at the front of received_server_states which were already emitted
+    size_t num_retained_states = 0;
+    // the tick of received_server_states.front()
+    uint64_t first_stored_tick = 0;
+
+    bool pushed_any_sequence = false;
+    uint64_t highest_pushed_sequence = 0;
+    size_t states_recovered_from_redundancy = 0;
+    size_t states_lost = 0;
+    size_t duplicate_states_ignored = 0;
+    size_t late_states_dropped = 0;
+    // sequences below highest_pushed_sequence that haven't arrived yet, in ascending order
+    std::deque<uint64_t> missing_sequences;
+    static constexpr size_t max_tracked_missing_sequences = 64;
+
+    size_t last_update_skipped_ticks = 0;
+    std::optional<QuantizedTickClock::clock::time_point> last_update_emit_time;
+
+    QuantizedTickClock::clock::time_point upcoming_vsync_time{};
+    QuantizedTickClock::clock::duration upcoming_vsync_period{};
+    // reused between ticks so batched catch up doesn't allocate once it has grown
+    std::vector<T> catch_up_batch;
+
+    double playback_speed = 1.0;
+    // fractional states owed to the output, every output signal adds playback_speed
+    double playback_credit = 0.0;
+};
+
+/**
+ * @brief A quantizer for pacing client input commands into the server's fixed simulation tick. Inputs can't be
+ * dropped, so whenever one would be (overflow past `max_buffered_states`, or a skip) it's merged into the next with
+ * `Merge`, see `MergeOnOverflow`. The buffer is kept shallow by default so inputs stay responsive.
+ */
+template <typename T, typename Merge, typename Hooks = NoQuantizerHooks>
+class ClientInputQuantizer : public NetworkedPeriodicSignalQuantizer<T, Hooks, MergeOnOverflow<Merge>> {
+  public:
+    static constexpr unsigned int default_num_states_to_wait_for_after_empty = 2;
+    static constexpr size_t default_max_buffered_states = 4;
+
+    ClientInputQuantizer() {
+        this->num_states_to_wait_for_after_empty = default_num_states_to_wait_for_after_empty;
+        this->max_buffered_states = default_max_buffered_states;
+    }
+};
+
+/**
+ * @brief A histogram of how late emits happened relative to their deadline, in fixed width microsecond buckets.
+ */
+class EmitTimingErrorHistogram {
+  public:
+    static constexpr std::chrono::microseconds bucket_width{10};
+    /// @brief the last bucket collects everything at or beyond num_buckets * bucket_width
+    static constexpr size_t num_buckets = 50;
+
+    void record(std::chrono::nanoseconds error) {
+        auto bucket = static_cast<size_t>(std::max<int64_t>(error / bucket_width, 0));
+        bucket_counts[std::min(bucket, num_buckets - 1)]++;
+
+        if (error < std::chrono::nanoseconds::zero())
+            num_early++;
+        num_samples++;
+        sum_error_ns += static_cast<double>(error.count());
+        max_error = std::max(max_error, error);
+    }
+
+    const std::array<size_t, num_buckets> &get_bucket_counts() const { return bucket_counts; }
+    size_t get_sample_count() const { return num_samples; }
+    /// @brief emits that happened before their deadline, they land in the first bucket
+    size_t get_early_count() const { return num_early; }
+    double get_mean_error_us() const { return num_samples == 0 ? 0.0 : sum_error_ns / num_samples / 1000.0; }
+    std::chrono::nanoseconds get_max_error() const { return max_error; }
+
+    /// @brief the fraction of emits whose error was within the given bound, at bucket resolution
+    double get_fraction_within(std::chrono::microseconds bound) const {
+        if (num_samples == 0)
+            return 0.0;
+        auto num_buckets_within = std::min(static_cast<size_t>(bound / bucket_width), num_buckets - 1);
+        size_t count = 0;
+        for (size_t i = 0; i < num_buckets_within; i++)
+            count += bucket_counts[i];
+        return static_cast<double>(count) / static_cast<double>(num_samples);
+    }
+
+    void reset() { *this = EmitTimingErrorHistogram(); }
+
+  private:
+    std::array<size_t, num_buckets> bucket_counts{};
+    size_t num_samples = 0;
+    size_t num_early = 0;
+    double sum_error_ns = 0.0;
+    std::chrono::nanoseconds max_error{0};
+};
+
+/**
+ * @brief Drives a `NetworkedPeriodicSignalQuantizer` so emits land very close to their deadline without burning a core.
+ *
+ * The driver sleeps until `spin_window` before the next emit deadline, then spins with pause instructions until the
+ * deadline and calls `update`. Sleeping alone overshoots by the scheduler's wakeup latency and spinning the whole time
+ * wastes a core, so the spin window should be just above the typical wakeup latency of the system. How late each emit
+ * actually happened, measured from the moment `update` emitted, is recorded in `get_emit_error_histogram`.
+ *
+ * @note run the driver on its own thread and push from any other thread through the driver's `push` (or
+ * `with_locked_quantizer`), those are serialized with `update` by a mutex which isn't held while sleeping or spinning,
+ * so states are pushed the moment they arrive. Subscribers of the quantizer run under that mutex and mustn't call back
+ * into the driver.
+ */
+template <typename Quantizer> class HybridSleepSpinEmitDriver {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    explicit HybridSleepSpinEmitDriver(Quantizer &quantizer) : quantizer(quantizer) {}
+
+    std::chrono::microseconds spin_window{200};
+    /// @brief how long to sleep between checks while the quantizer hasn't started yet
+    std::chrono::milliseconds idle_poll_interval{1};
+
+    /// @brief thread safe push into the quantizer
+    template <typename State> void push(const State &state) {
+        std::lock_guard<std::mutex> lock(quantizer_mutex);
+        quantizer.push(state);
+    }
+
+    /// @brief runs function(quantizer) while holding the quantizer mutex, for anything other than a plain push
+    template <typename Function> decltype(auto) with_locked_quantizer(Function &&function) {
+        std::lock_guard<std::mutex> lock(quantizer_mutex);
+        return std::forward<Function>(function)(quantizer);
+    }
+
+    /// @brief waits for the next emit deadline and updates the quantizer once
+    void run_once() {
+        std::unique_lock<std::mutex> lock(quantizer_mutex);
+        if (not quantizer.pushed_first_element) {
+            lock.unlock();
+            std::this_thread::sleep_for(idle_poll_interval);
+            lock.lock();
+            quantizer.update();
+            return;
+        }
+
+        clock::time_point deadline = quantizer.output_signal.get_next_tick_time();
+        lock.unlock();
+
+        clock::time_point wake_time = deadline - spin_window;
+        if (clock::now() < wake_time)
+            std::this_thread::sleep_until(wake_time);
+
+        while (clock::now() < deadline) {
+            cpu_relax();
+        }
+
+        lock.lock();
+        quantizer.update();
+        if (auto emit_time = quantizer.get_last_update_emit_time())
+            emit_error_histogram.record(*emit_time - deadline);
+    }
+
+    /// @brief calls `run_once` until `keep_running` becomes false
+    void run(const std::atomic<bool> &keep_running) {
+        while (keep_running.load(std::memory_order_relaxed))
+            run_once();
+    }
+
+    /// @brief only read this from the driver thread or once `run` has returned
+    const EmitTimingErrorHistogram &get_emit_error_histogram() const { return emit_error_histogram; }
+    void reset_emit_error_histogram() { emit_error_histogram.reset(); }
+
+  private:
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield");
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    Quantizer &quantizer;
+    std::mutex quantizer_mutex;
+    EmitTimingErrorHistogram emit_error_histogram;
+};
+
+/**
+ * @brief emitted by an interpolating output of `NetworkedPeriodicSignalFanOutQuantizer`, the states are only valid
+ * during the emit
+ */
+template <typename T> struct QuantizedInterpolationPair {
+    const T *current;
+    const T *next;
+    /// @brief how far we are from current to next in [0, 1]
+    double progress;
+};
+
+/**
+ * @brief Quantizes one input stream into several outputs running at their own rates, without copying the states.
+ *
+ * Every output is an `OutputCursor` with its own `PeriodicSignal`, emitter and buffer health, but they all read from
+ * the same buffer of received states. A state is only freed once every cursor has moved past it.
+ *
+ * A regular output consumes one state per tick of its own signal and emits `std::optional<T>`, so its rate must be at
+ * or below the input rate or it runs dry. For outputs faster than the input use `add_interpolating_output`, for example
+ * physics can consume the server's 60hz ticks while rendering runs a 144hz interpolating output.
+ *
+ * @tparam T The type of the server state to be buffered and emitted.
+ */
+template <typename T> class NetworkedPeriodicSignalFanOutQuantizer {
+  public:
+    class OutputCursor {
+      public:
+        explicit OutputCursor(double rate_hz, uint64_t next_state_index)
+            : output_signal(rate_hz), next_state_index(next_state_index) {}
+
+        OutputCursor(double rate_hz, double input_rate_hz, uint64_t next_state_index)
+            : output_signal(rate_hz), next_state_index(next_state_index) {
+            state_advance_signal.emplace(input_rate_hz);
+        }
+
+        /// @brief decides when this cursor emits, a plain `PeriodicSignal` so unlike the `QuantizedTickClock` of
+        /// `NetworkedPeriodicSignalQuantizer` it only reports whether a tick elapsed, not how many
+        PeriodicSignal output_signal;
+        /// @brief the emitter which you should bind to receive the states of this cursor
+        SignalEmitter output_emitter;
+
+        unsigned int num_states_to_wait_for_after_empty = 4;
+
+        double get_missed_emit_percentage() const { return emit_gate.get_missed_emit_percentage(); }
+
+        bool is_interpolating() const { return state_advance_signal.has_value(); }
+
+      private:
+        friend class NetworkedPeriodicSignalFanOutQuantizer;
+
+        /// @brief the state before next_state_index if the cursor is interpolating and has moved past one
+        uint64_t get_oldest_needed_state_index() const {
+            return has_current_state ? next_state_index - 1 : next_state_index;
+        }
+
+        uint64_t next_state_index;
+        QuantizedEmitGate emit_gate;
+
+        // only set for interpolating cursors, moves the cursor through the states at the input rate
+        std::optional<PeriodicSignal> state_advance_signal;
+        bool has_current_state = false;
+    };
+
+    /**
+     * @brief adds a new output that consumes one state per tick, it starts reading from the oldest state still
+     * buffered
+     * @note the returned reference stays valid for the lifetime of the quantizer
+     */
+    OutputCursor &add_output(double rate_hz) {
+        OutputCursor &cursor = output_cursors.emplace_back(rate_hz, first_buffered_state_index);
+        if (pushed_first_element)
+            cursor.output_signal.restart();
+        return cursor;
+    }
+
+    /**
+     * @brief adds an output which can run faster than the input, it moves through the states at `input_rate_hz` and on
+     * every tick of its own signal emits `std::optional<QuantizedInterpolationPair<T>>` with the state it's on, the
+     * one after it and how far it is between them. nullopt is emitted until it has a pair, and while refilling.
+     * @note the returned reference stays valid for the lifetime of the quantizer
+     */
+    OutputCursor &add_interpolating_output(double rate_hz, double input_rate_hz) {
+        OutputCursor &cursor = output_cursors.emplace_back(rate_hz, input_rate_hz, first_buffered_state_index);
+        if (pushed_first_element) {
+            cursor.output_signal.restart();
+            cursor.state_advance_signal->restart();
+        }
+        return cursor;
+    }
+
+    size_t get_output_count() const { return output_cursors.size(); }
+    OutputCursor &get_output(size_t index) { return output_cursors[index]; }
+
+    /// @brief once more than this many states are buffered the oldest are dropped, lagging cursors skip them
+    size_t max_buffered_states = 0;
+
+    ArrivalIntervalStatistics received_state_arrival_statistics;
+
+    void push(const T &item) {
+        received_server_states.push_back(item);
+        received_state_arrival_statistics.record_arrival();
+
+        if (max_buffered_states != 0 and received_server_states.size() > max_buffered_states) {
+            size_t num_to_drop = received_server_states.size() - max_buffered_states;
+            received_server_states.erase(received_server_states.begin(),
+                                         received_server_states.begin() + static_cast<std::ptrdiff_t>(num_to_drop));
+            first_buffered_state_index += num_to_drop;
+            for (auto &cursor : output_cursors) {
+                if (cursor.get_oldest_needed_state_index() < first_buffered_state_index) {
+                    cursor.next_state_index = std::max(cursor.next_state_index, first_buffered_state_index);
+                    cursor.has_current_state = false;
+                }
+            }
+        }
+
+        if (not pushed_first_element) {
+            pushed_first_element = true;
+            for (auto &cursor : output_cursors) {
+                cursor.output_signal.restart();
+                if (cursor.state_advance_signal)
+                    cursor.state_advance_signal->restart();
+            }
+        }
+    }
+
+    /**
+     * @brief Call periodically, every cursor emits at its own rate and states consumed by all of them are freed.
+     */
+    void update() {
+        if (not pushed_first_element)
+            return;
+
+        for (auto &cursor : output_cursors) {
+            update_cursor(cursor);
+        }
+
+        free_states_consumed_by_every_cursor();
+    }
+
+    /// @brief the number of states a cursor has yet to emit
+    size_t get_buffered_state_count(const OutputCursor &cursor) const {
+        return static_cast<size_t>(end_state_index() - cursor.next_state_index);
+    }
+
+    /// @brief the number of states held in memory, shared by all cursors
+    size_t get_stored_state_count() const { return received_server_states.size(); }
+
+  private:
+    uint64_t end_state_index() const { return first_buffered_state_index + received_server_states.size(); }
+
+    const T &get_state(uint64_t state_index) const {
+        return received_server_states[static_cast<size_t>(state_index - first_buffered_state_index)];
+    }
+
+    void update_cursor(OutputCursor &cursor) {
+        if (cursor.is_interpolating()) {
+            update_interpolating_cursor(cursor);
+            return;
+        }
+
+        if (not cursor.output_signal.process_and_get_signal())
+            return;
+
+        std::optional<T> emitted_value = std::nullopt;
+
+        auto decision = cursor.emit_gate.on_emit_opportunity(get_buffered_state_count(cursor),
+                                                             cursor.num_states_to_wait_for_after_empty);
+        if (decision == QuantizedEmitGate::Decision::emit) {
+            emitted_value = get_state(cursor.next_state_index);
+            cursor.next_state_index++;
+            cursor.emit_gate.on_emitted(get_buffered_state_count(cursor));
+        }
+
+        cursor.output_emitter.emit(emitted_value);
+    }
+
+    // the cursor steps through the states at the input rate, its own signal only decides when a pair is emitted
+    void update_interpolating_cursor(OutputCursor &cursor) {
+        if (cursor.state_advance_signal->process_and_get_signal()) {
+            auto decision = cursor.emit_gate.on_emit_opportunity(get_buffered_state_count(cursor),
+                                                                 cursor.num_states_to_wait_for_after_empty);
+            if (decision == QuantizedEmitGate::Decision::emit) {
+                cursor.next_state_index++;
+                cursor.has_current_state = true;
+                cursor.emit_gate.on_emitted(get_buffered_state_count(cursor));
+            }
+        }
+
+        if (not cursor.output_signal.process_and_get_signal())
+            return;
+
+        std::optional<QuantizedInterpolationPair<T>> emitted_pair = std::nullopt;
+        if (cursor.has_current_state and not cursor.emit_gate.is_refilling() and
+            get_buffered_state_count(cursor) != 0) {
+            emitted_pair = QuantizedInterpolationPair<T>{&get_state(cursor.next_state_index - 1),
+                                                         &get_state(cursor.next_state_index),
+                                                         cursor.state_advance_signal->get_cycle_progess()};
+        }
+
+        cursor.output_emitter.emit(emitted_pair);
+    }
+
+    void free_states_consumed_by_every_cursor() {
+        uint64_t oldest_needed_index = end_state_index();
+        for (const auto &cursor : output_cursors) {
+            oldest_needed_index = std::min(oldest_needed_index, cursor.get_oldest_needed_state_index());
+        }
+
+        while (first_buffered_state_index < oldest_needed_index) {
+            received_server_states.pop_front();
+            first_buffered_state_index++;
+        }
+    }
+
+    std::deque<T> received_server_states;
+    // the absolute index of received_server_states.front(), counting every state ever pushed
+    uint64_t first_buffered_state_index = 0;
+    std::deque<OutputCursor> output_cursors;
+    bool pushed_first_element = false;
+};
+
+/**
+ * @brief Quantizes many streams that are updated by the same server packets as one group, so every member shows the
+ * same server tick on the same frame.
+ *
+ * With a quantizer per stream each one decides on its own whether to emit or miss, so one frame can show some entities
+ * at tick N and others at N - 1. Here states are buffered per server tick, and a single clock and `QuantizedEmitGate`
+ * decide for the whole group, then every member gets its state of the emitted tick. This also means there's only one
+ * set of timing work per group instead of one per stream.
+ *
+ * @tparam MemberId identifies a member stream, must be hashable
+ * @tparam T the per member state
+ */
+template <typename MemberId, typename T> class NetworkedTickGroupQuantizer {
+  public:
+    QuantizedTickClock output_signal{60};
+
+    /// @brief emits `std::optional<T>` for this member on every tick, nullopt if the tick had no state for it or missed
+    SignalEmitter &get_member_emitter(const MemberId &member) { return members[member].emitter; }
+    void remove_member(const MemberId &member) { members.erase(member); }
+
+    /// @brief counted in server ticks, not in states
+    unsigned int num_states_to_wait_for_after_empty = 4;
+
+    /// @brief see `NetworkedPeriodicSignalQuantizer::stall_policy`, a tick that is skipped drops its whole frame
+    QuantizerStallPolicy stall_policy = QuantizerStallPolicy::emit_every_tick;
+    size_t max_ticks_per_update = 8;
+
+    /**
+     * @brief buffer a member's state for a server tick, states for ticks that were already emitted are dropped
+     */
+    void push(const MemberId &member, uint64_t server_tick, const T &state) {
+        if (emitted_any_tick and server_tick <= last_emitted_server_tick) {
+            late_states_dropped++;
+            return;
+        }
+
+        get_or_insert_frame(server_tick).member_states.emplace_back(member, state);
+
+        if (not pushed_first_element) {
+            pushed_first_element = true;
+            output_signal.restart();
+        }
+    }
+
+    void update() {
+        if (not pushed_first_element)
+            return;
+
+        last_update_skipped_ticks =
+            handle_elapsed_ticks(output_signal.process_and_get_elapsed_ticks(), stall_policy, max_ticks_per_update,
+                                 [this](size_t num_ticks) { process_emit_opportunity(num_ticks); });
+    }
+
+    /// @brief the number of distinct server ticks waiting to be emitted
+    size_t get_buffered_tick_count() const { return buffered_ticks.size(); }
+    std::optional<uint64_t> get_last_emitted_server_tick() const {
+        return emitted_any_tick ? std::optional<uint64_t>(last_emitted_server_tick) : std::nullopt;
+    }
+    size_t get_late_states_dropped() const { return late_states_dropped; }
+    double get_missed_emit_percentage() const { return emit_gate.get_missed_emit_percentage(); }
+    /// @brief see `NetworkedPeriodicSignalQuantizer::get_last_update_skipped_ticks`
+    size_t get_last_update_skipped_ticks() const { return last_update_skipped_ticks; }
+
+  private:
+    struct TickFrame {
+        uint64_t server_tick;
+        std::vector<std::pair<MemberId, T>> member_states;
+    };
+
+    void process_emit_opportunity(size_t num_ticks) {
+        auto decision = emit_gate.on_emit_opportunity(buffered_ticks.size(), num_states_to_wait_for_after_empty);
+        if (decision != QuantizedEmitGate::Decision::emit) {
+            emit_to_all_members(std::nullopt);
+            return;
+        }
+
+        // the frames of ticks that elapsed without their own opportunity are dropped so they don't stay as latency
+        for (size_t i = 1; i < num_ticks and buffered_ticks.size() > 1; i++) {
+            recycle_member_states(std::move(buffered_ticks.front().member_states));
+            buffered_ticks.pop_front();
+        }
+
+        TickFrame frame = std::move(buffered_ticks.front());
+        buffered_ticks.pop_front();
+        emit_gate.on_emitted(buffered_ticks.size());
+        last_emitted_server_tick = frame.server_tick;
+        emitted_any_tick = true;
+
+        emit_count++;
+        for (auto &[member_id, state] : frame.member_states) {
+            auto it = members.find(member_id);
+            if (it == members.end())
+                continue;
+            std::optional<T> value = std::move(state);
+            it->second.emitter.emit(value);
+            it->second.last_emit_count = emit_count;
+        }
+
+        // everyone who had nothing in this tick still hears about it, so all members stay on the same tick
+        for (auto &[member_id, member] : members) {
+            if (member.last_emit_count != emit_count)
+                member.emitter.emit(std::optional<T>(std::nullopt));
+        }
+
+        recycle_member_states(std::move(frame.member_states));
+    }
+
+    // ticks almost always arrive in order, so the frame is nearly always the last one or a new one after it
+    TickFrame &get_or_insert_frame(uint64_t server_tick) {
+        if (buffered_ticks.empty() or buffered_ticks.back().server_tick < server_tick) {
+            return buffered_ticks.emplace_back(TickFrame{server_tick, take_spare_member_states()});
+        }
+
+        auto it = std::lower_bound(buffered_ticks.begin(), buffered_ticks.end(), server_tick,
+                                   [](const TickFrame &frame, uint64_t tick) { return frame.server_tick < tick; });
+        if (it != buffered_ticks.end() and it->server_tick == server_tick)
+            return *it;
+        return *buffered_ticks.insert(it, TickFrame{server_tick, take_spare_member_states()});
+    }
+
+    void recycle_member_states(std::vector<std::pair<MemberId, T>> member_states) {
+        member_states.clear();
+        spare_member_states.push_back(std::move(member_states));
+    }
+
+    std::vector<std::pair<MemberId, T>> take_spare_member_states() {
+        if (spare_member_states.empty())
+            return {};
+        auto member_states = std::move(spare_member_states.back());
+        spare_member_states.pop_back();
+        return member_states;
+    }
+
+    void emit_to_all_members(const std::optional<T> &value) {
+        for (auto &[member_id, member] : members)
+            member.emitter.emit(value);
+    }
+
+    struct Member {
+        SignalEmitter emitter;
+        // equal to emit_count when this member already got its state during the current emit
+        uint64_t last_emit_count = 0;
+    };
+
+    std::deque<TickFrame> buffered_ticks;
+    // the vectors of emitted frames are kept so their capacity is reused instead of reallocated every tick
+    std::vector<std::vector<std::pair<MemberId, T>>> spare_member_states;
+    std::unordered_map<MemberId, Member> members;
+    uint64_t emit_count = 0;
+
+    QuantizedEmitGate emit_gate;
+    bool pushed_first_element = false;
+    bool emitted_any_tick = false;
+    uint64_t last_emitted_server_tick = 0;
+    size_t late_states_dropped = 0;
+    size_t last_update_skipped_ticks = 0;
+};
+
+/**
+ * @brief Quantizes whole world snapshots and hands out per entity views of them at emit time, instead of splitting
+ * every snapshot into one copy per entity pushed into thousands of per entity quantizers.
+ *
+ * Each snapshot is buffered once (behind a `std::shared_ptr`), and the timing and buffer health work happens once per
+ * snapshot. Per entity subscribers are still possible through `get_entity_emitter`, they receive a view of their entity
+ * extracted from the emitted snapshot, and `get_entity_view` gives pull style access to the last emitted one.
+ *
+ * @tparam Snapshot the world snapshot type
+ * @tparam EntityId identifies an entity within a snapshot, must be hashable
+ * @tparam ViewAccessor a default constructible functor `std::optional<View> operator()(const Snapshot &, const
+ * EntityId &) const` returning a cheap view (e.g. a pointer or span) of an entity, or nullopt when it's not in the
+ * snapshot. Views must only reference data owned by the snapshot.
+ */
+template <typename Snapshot, typename EntityId, typename ViewAccessor> class WorldSnapshotQuantizer {
+  public:
+    using SnapshotPtr = std::shared_ptr<const Snapshot>;
+    using View = typename std::invoke_result_t<ViewAccessor, const Snapshot &, const EntityId &>::value_type;
+
+    QuantizedTickClock output_signal{60};
+    /// @brief emits `std::optional<SnapshotPtr>` every tick, for consumers that want the whole snapshot
+    SignalEmitter output_emitter;
+
+    unsigned int num_states_to_wait_for_after_empty = 4;
+    /// @brief once more than this many snapshots are buffered the oldest ones are dropped, 0 means unbounded
+    size_t max_buffered_snapshots = 0;
+
+    /// @brief see `NetworkedPeriodicSignalQuantizer::stall_policy`
+    QuantizerStallPolicy stall_policy = QuantizerStallPolicy::emit_every_tick;
+    size_t max_ticks_per_update = 8;
+
+    ArrivalIntervalStatistics received_snapshot_arrival_statistics;
+
+    /// @brief emits `std::optional<View>` for this entity every tick, nullopt on a miss or when it isn't in the
+    /// snapshot
+    SignalEmitter &get_entity_emitter(const EntityId &entity) { return entity_emitters[entity]; }
+    void remove_entity_subscription(const EntityId &entity) { entity_emitters.erase(entity); }
+
+    void push(SnapshotPtr snapshot) {
+        received_snapshots.push_back(std::move(snapshot));
+        received_snapshot_arrival_statistics.record_arrival();
+
+        while (max_buffered_snapshots != 0 and received_snapshots.size() > max_buffered_snapshots)
+            received_snapshots.pop_front();
+
+        if (not pushed_first_element) {
+            pushed_first_element = true;
+            output_signal.restart();
+        }
+    }
+
+    void push(Snapshot &&snapshot) { push(std::make_shared<const Snapshot>(std::move(snapshot))); }
+
+    void update() {
+        if (not pushed_first_element)
+            return;
+
+        last_update_skipped_ticks =
+            handle_elapsed_ticks(output_signal.process_and_get_elapsed_ticks(), stall_policy, max_ticks_per_update,
+                                 [this](size_t num_ticks) { process_emit_opportunity(num_ticks); });
+    }
+
+    /// @brief the view of an entity in the most recently emitted snapshot
+    std::optional<View> get_entity_view(const EntityId &entity) const {
+        if (current_snapshot == nullptr)
+            return std::nullopt;
+        return ViewAccessor{}(*current_snapshot, entity);
+    }
+
+    /// @brief keeps the snapshot alive for as long as the caller holds on to it
+    const SnapshotPtr &get_current_snapshot() const { return current_snapshot; }
+
+    size_t get_buffered_snapshot_count() const { return received_snapshots.size(); }
+    double get_missed_emit_percentage() const { return emit_gate.get_missed_emit_percentage(); }
+    /// @brief see `NetworkedPeriodicSignalQuantizer::get_last_update_skipped_ticks`
+    size_t get_last_update_skipped_ticks() const { return last_update_skipped_ticks; }
+
+  private:
+    void process_emit_opportunity(size_t num_ticks) {
+        if (emit_gate.on_emit_opportunity(received_snapshots.size(), num_states_to_wait_for_after_empty) !=
+            QuantizedEmitGate::Decision::emit) {
+            // the last emitted snapshot is kept so get_entity_view keeps working through a miss
+            output_emitter.emit(std::optional<SnapshotPtr>(std::nullopt));
+            for (auto &[entity, emitter] : entity_emitters)
+                emitter.emit(std::optional<View>(std::nullopt));
+            return;
+        }
+
+        // the snapshots of ticks that elapsed without their own opportunity are skipped
+        for (size_t i = 1; i < num_ticks and received_snapshots.size() > 1; i++)
+            received_snapshots.pop_front();
+
+        current_snapshot = std::move(received_snapshots.front());
+        received_snapshots.pop_front();
+        emit_gate.on_emitted(received_snapshots.size());
+
+        output_emitter.emit(std::optional<SnapshotPtr>(current_snapshot));
+        for (auto &[entity, emitter] : entity_emitters)
+            emitter.emit(get_entity_view(entity));
+    }
+
+    std::deque<SnapshotPtr> received_snapshots;
+    SnapshotPtr current_snapshot;
+    std::unordered_map<EntityId, SignalEmitter> entity_emitters;
+    QuantizedEmitGate emit_gate;
+    bool pushed_first_element = false;
+    size_t last_update_skipped_ticks = 0;
+};
+
+/**
+ * @brief The server side counterpart of the quantizer, paces outgoing snapshots to one client evenly instead of sending
+ * them in a burst whenever the simulation finishes.
+ *
+ * Snapshots are pushed as soon as they're produced and `output_emitter` fires at the send rate, the moment the send is
+ * due the oldest queued snapshot is handed over to be sent. Each client gets a phase offset within the tick so the
+ * sends of all clients are spread over the whole tick rather than all happening right after the simulation step, use
+ * `get_evenly_spread_phase_offset` to pick one. Smoothing the sends lowers the arrival jitter clients see, which lets
+ * their `NetworkedPeriodicSignalQuantizer` run with a shallower buffer.
+ *
+ * @tparam T the outgoing snapshot type
+ */
+template <typename T> class NetworkedSendPacer {
+  public:
+    /**
+     * @param send_rate_hz should match the server tick rate
+     * @param phase_offset_fraction in [0, 1), how far into the tick (measured from the first push) sends happen
+     */
+    NetworkedSendPacer(double send_rate_hz, double phase_offset_fraction)
+        : output_signal(send_rate_hz),
+          phase_offset(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double>(std::clamp(phase_offset_fraction, 0.0, 1.0) / send_rate_hz))) {}
+
+    /**
+     * @brief the phase offset of a client when `client_count` clients share a tick, each one gets the middle of its own
+     * slot so even the first client sends a little after the simulation step rather than racing it
+     */
+    static double get_evenly_spread_phase_offset(size_t client_index, size_t client_count) {
+        if (client_count == 0)
+            return 0.5;
+        return (static_cast<double>(client_index % client_count) + 0.5) / static_cast<double>(client_count);
+    }
+
+    PeriodicSignal output_signal;
+    /// @brief bind to this to actually send the snapshots to the client
+    SignalEmitter output_emitter;
+
+    /// @brief if the client link can't keep up the oldest queued snapshots are dropped, they're stale anyway
+    size_t max_queued_snapshots = 2;
+
+    void push(const T &snapshot) {
+        queued_snapshots.push_back(snapshot);
+        while (max_queued_snapshots != 0 and queued_snapshots.size() > max_queued_snapshots) {
+            queued_snapshots.pop_front();
+            dropped_snapshots++;
+        }
+
+        if (not pushed_first_element) {
+            pushed_first_element = true;
+            first_push_time = std::chrono::steady_clock::now();
+        }
+    }
+
+    void update() {
+        if (not pushed_first_element)
+            return;
+
+        if (not started_sending) {
+            if (std::chrono::steady_clock::now() - first_push_time < phase_offset)
+                return;
+            started_sending = true;
+            output_signal.restart();
+        }
+
+        if (not output_signal.process_and_get_signal())
+            return;
+
+        // the server doesn't need a safety margin or a refill period like the client's QuantizedEmitGate, anything
+        // queued goes out right away and a send is only missed when nothing is queued
+        total_send_opportunities++;
+        if (queued_snapshots.empty()) {
+            missed_send_opportunities++;
+            return;
+        }
+
+        std::optional<T> snapshot = std::move(queued_snapshots.front());
+        queued_snapshots.pop_front();
+        output_emitter.emit(snapshot);
+    }
+
+    size_t get_queued_snapshot_count() const { return queued_snapshots.size(); }
+    size_t get_dropped_snapshot_count() const { return dropped_snapshots; }
+    /// @brief how often a send was due but the simulation hadn't produced a snapshot yet
+    double get_missed_send_percentage() const {
+        if (total_send_opportunities == 0)
+            return 0.0;
+        return (double)missed_send_opportunities * 100.0 / (double)total_send_opportunities;
+    }
+
+  private:
+    std::deque<T> queued_snapshots;
+    size_t total_send_opportunities = 0;
+    size_t missed_send_opportunities = 0;
+    std::chrono::steady_clock::duration phase_offset;
+    std::chrono::steady_clock::time_point first_push_time{};
+    bool pushed_first_element = false;
+    bool started_sending = false;
+    size_t dropped_snapshots = 0;
+};
+
+#ifdef NPSQ_HAS_POSIX_SHARED_MEMORY
+
+/**
+ * @brief A lock-free single producer single consumer ring of states living in a POSIX shared memory segment.
+ *
+ * This lets a network process push states that a render process consumes without any serialization or sockets in
+ * between. The producer creates the segment with `create` and the consumer attaches with `open`, the creator unlinks
+ * the segment when it goes away.
+ *
+ * @note when the ring is full `try_push` fails and the state is dropped, the consumer is the only one that decides
+ * which states are skipped so the producer never has to touch the read side
+ */
+template <typename T, size_t Capacity = 256> class SharedMemoryStateRing {
+    static_assert(std::is_trivially_copyable_v<T>, "states shared between processes must be trivially copyable");
+    static_assert(Capacity != 0 and (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring indices must be lock free to be shared");
+
+    struct Layout {
+        std::atomic<uint32_t> initialized;
+        alignas(64) std::atomic<uint64_t> write_index;
+        alignas(64) std::atomic<uint64_t> read_index;
+        alignas(64) std::atomic<uint64_t> dropped_states;
+        alignas(64) T states[Capacity];
+    };
+
+    static constexpr uint32_t initialized_magic = 0x4e505351; // "NPSQ"
+
+  public:
+    /**
+     * @brief creates a new segment, if one with this name already exists this throws a `std::system_error` with
+     * `EEXIST` rather than taking over a segment that may still be in use, see `remove` for clearing a stale one
+     */
+    static SharedMemoryStateRing create(const std::string &name) {
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd == -1)
+            throw std::system_error(errno, std::generic_category(), "shm_open failed for " + name);
+
+        if (ftruncate(fd, sizeof(Layout)) == -1) {
+            int error = errno;
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "ftruncate failed for " + name);
+        }
+
+        SharedMemoryStateRing ring(map_segment(fd, name, true), name, true);
+        new (&ring.layout->write_index) std::atomic<uint64_t>(0);
+        new (&ring.layout->read_index) std::atomic<uint64_t>(0);
+        new (&ring.layout->dropped_states) std::atomic<uint64_t>(0);
+        new (&ring.layout->initialized) std::atomic<uint32_t>(0);
+        ring.layout->initialized.store(initialized_magic, std::memory_order_release);
+        return ring;
+    }
+
+    /**
+     * @brief attaches to a segment made by `create`, throws if it doesn't exist or the producer hasn't finished setting
+     * it up yet, in which case the consumer should simply try again a little later
+     */
+    static SharedMemoryStateRing open(const std::string &name) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd == -1)
+            throw std::system_error(errno, std::generic_category(), "shm_open failed for " + name);
+
+        // between the producer's shm_open and ftruncate the segment is empty, touching it then would raise SIGBUS
+        struct stat segment_status {};
+        if (fstat(fd, &segment_status) == -1) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "fstat failed for " + name);
+        }
+        if (static_cast<size_t>(segment_status.st_size) < sizeof(Layout)) {
+            close(fd);
+            throw std::runtime_error("shared memory segment " + name + " has not been sized by its producer yet");
+        }
+
+        SharedMemoryStateRing ring(map_segment(fd, name, false), name, false);
+        if (ring.layout->initialized.load(std::memory_order_acquire) != initialized_magic)
+            throw std::runtime_error("shared memory segment " + name + " has not been initialized by its producer");
+        return ring;
+    }
+
+    /// @brief unlinks a segment left behind by a producer that didn't shut down cleanly, so `create` can succeed again
+    static void remove(const std::string &name) { shm_unlink(name.c_str()); }
+
+    SharedMemoryStateRing(SharedMemoryStateRing &&other) noexcept
+        : layout(std::exchange(other.layout, nullptr)), name(std::move(other.name)),
+          is_owner(std::exchange(other.is_owner, false)) {}
+
+    SharedMemoryStateRing &operator=(SharedMemoryStateRing &&other) noexcept {
+        if (this != &other) {
+            release();
+            layout = std::exchange(other.layout, nullptr);
+            name = std::move(other.name);
+            is_owner = std::exchange(other.is_owner, false);
+        }
+        return *this;
+    }
+
+    SharedMemoryStateRing(const SharedMemoryStateRing &) = delete;
+    SharedMemoryStateRing &operator=(const SharedMemoryStateRing &) = delete;
+
+    ~SharedMemoryStateRing() { release(); }
+
+    /// @brief producer side
+    bool try_push(const T &state) {
+        uint64_t write = layout->write_index.load(std::memory_order_relaxed);
+        if (write - layout->read_index.load(std::memory_order_acquire) == Capacity) {
+            layout->dropped_states.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        layout->states[write & (Capacity - 1)] = state;
+        layout->write_index.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief consumer side, the oldest state, only valid until the next `pop`
+    const T *peek() const {
+        uint64_t read = layout->read_index.load(std::memory_order_relaxed);
+        if (read == layout->write_index.load(std::memory_order_acquire))
+            return nullptr;
+        return &layout->states[read & (Capacity - 1)];
+    }
+
+    /// @brief consumer side
+    void pop() { layout->read_index.fetch_add(1, std::memory_order_release); }
+
+    size_t size() const {
+        return static_cast<size_t>(layout->write_index.load(std::memory_order_acquire) -
+                                   layout->read_index.load(std::memory_order_acquire));
+    }
+
+    size_t get_dropped_state_count() const { return layout->dropped_states.load(std::memory_order_relaxed); }
+
+  private:
+    SharedMemoryStateRing(Layout *layout, std::string name, bool is_owner)
+        : layout(layout), name(std::move(name)), is_owner(is_owner) {}
+
+    /// @param is_owner when set a failed mapping also unlinks the segment, nothing else would remove it
+    static Layout *map_segment(int fd, const std::string &name, bool is_owner) {
+        void *memory = mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if (memory == MAP_FAILED) {
+            if (is_owner)
+                shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "mmap failed for " + name);
+        }
+        return static_cast<Layout *>(memory);
+    }
+
+    void release() {
+        if (layout == nullptr)
+            return;
+        munmap(layout, sizeof(Layout));
+        if (is_owner)
+            shm_unlink(name.c_str());
+        layout = nullptr;
+    }
+
+    Layout *layout = nullptr;
+    std::string name;
+    bool is_owner = false;
+};
+
+/**
+ * @brief The consumer half of a cross-process quantizer, emits states pushed into a `SharedMemoryStateRing` by another
+ * process at the quantized rate.
+ *
+ * The producing process just calls `try_push` on its end of the ring, this side behaves like
+ * `NetworkedPeriodicSignalQuantizer::update`. Nothing is copied out of the shared segment, `output_emitter` emits a
+ * `const T *` pointing at the state inside the segment (nullptr on a miss), which is only valid during the emit since
+ * the slot is handed back to the producer right after.
+ *
+ * @note the arrival timing isn't visible from this side, the output signal starts when the first state is seen
+ */
+template <typename T, size_t Capacity = 256> class SharedMemoryNetworkedPeriodicSignalQuantizer {
+  public:
+    explicit SharedMemoryNetworkedPeriodicSignalQuantizer(SharedMemoryStateRing<T, Capacity> ring)
+        : ring(std::move(ring)) {}
+
+    PeriodicSignal output_signal{60};
+    SignalEmitter output_emitter;
+
+    unsigned int num_states_to_wait_for_after_empty = 4;
+
+    void update() {
+        if (not seen_first_element) {
+            if (ring.size() == 0)
+                return;
+            seen_first_element = true;
+            output_signal.restart();
+        }
+
+        if (not output_signal.process_and_get_signal())
+            return;
+
+        if (emit_gate.on_emit_opportunity(ring.size(), num_states_to_wait_for_after_empty) !=
+            QuantizedEmitGate::Decision::emit) {
+            output_emitter.emit(static_cast<const T *>(nullptr));
+            return;
+        }
+
+        const T *emitted_state = ring.peek();
+        output_emitter.emit(emitted_state);
+        ring.pop();
+        emit_gate.on_emitted(ring.size());
+    }
+
+    size_t get_buffered_state_count() const { return ring.size(); }
+    double get_missed_emit_percentage() const { return emit_gate.get_missed_emit_percentage(); }
+
+  private:
+    SharedMemoryStateRing<T, Capacity> ring;
+    QuantizedEmitGate emit_gate;
+    bool seen_first_element = false;
+};
+
+/**
+ * @brief A FIFO of states that keeps only the newest `max_in_memory_states` in RAM and spills the older ones to a
+ * memory-mapped file, paging them back in as they reach the front.
+ *
+ * Because the oldest states are always the ones on disk the file is used as a ring, written at its tail and read at its
+ * head, so its size follows the largest backlog that was ever spilled rather than the total number of states that went
+ * through it. It only grows (doubling) when the backlog outgrows it.
+ *
+ * @note the file is created (and truncated) on construction and removed again on destruction
+ */
+template <typename T> class SpillingStateBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "spilled states are written to disk byte for byte");
+
+  public:
+    SpillingStateBuffer(std::string spill_file_path, size_t max_in_memory_states)
+        : spill_file_path(std::move(spill_file_path)), max_in_memory_states(max_in_memory_states) {
+        spill_fd = ::open(this->spill_file_path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+        if (spill_fd == -1)
+            throw std::system_error(errno, std::generic_category(), "failed to open " + this->spill_file_path);
+    }
+
+    SpillingStateBuffer(const SpillingStateBuffer &) = delete;
+    SpillingStateBuffer &operator=(const SpillingStateBuffer &) = delete;
+
+    ~SpillingStateBuffer() {
+        if (spilled_states != nullptr)
+            munmap(spilled_states, spill_capacity * sizeof(T));
+        if (spill_fd != -1) {
+            close(spill_fd);
+            unlink(spill_file_path.c_str());
+        }
+    }
+
+    void push_back(const T &state) {
+        in_memory_states.push_back(state);
+        if (in_memory_states.size() > max_in_memory_states) {
+            // the front of the in memory states is newer than everything on disk, so appending keeps the order
+            append_to_spill_file(in_memory_states.front());
+            in_memory_states.pop_front();
+        }
+    }
+
+    const T &front() const {
+        if (spilled_state_count != 0)
+            return spilled_states[spill_head];
+        return in_memory_states.front();
+    }
+
+    void pop_front() {
+        if (spilled_state_count == 0) {
+            in_memory_states.pop_front();
+            return;
+        }
+
+        spill_head = (spill_head + 1) % spill_capacity;
+        spilled_state_count--;
+        if (spilled_state_count == 0) {
+            // nothing on disk is needed anymore, so let the kernel take back the pages we had mapped in
+            spill_head = 0;
+            madvise(spilled_states, spill_capacity * sizeof(T), MADV_DONTNEED);
+        }
+    }
+
+    size_t size() const { return spilled_state_count + in_memory_states.size(); }
+    bool empty() const { return size() == 0; }
+
+    size_t get_spilled_state_count() const { return spilled_state_count; }
+    size_t get_in_memory_state_count() const { return in_memory_states.size(); }
+    /// @brief how many states the spill file currently has room for, its size on disk is this times sizeof(T)
+    size_t get_spill_file_capacity() const { return spill_capacity; }
+
+  private:
+    void append_to_spill_file(const T &state) {
+        if (spilled_state_count == spill_capacity)
+            grow_spill_file();
+        spilled_states[(spill_head + spilled_state_count) % spill_capacity] = state;
+        spilled_state_count++;
+    }
+
+    void grow_spill_file() {
+        size_t old_capacity = spill_capacity;
+        size_t new_capacity = std::max<size_t>(old_capacity * 2, initial_spill_capacity);
+
+        if (ftruncate(spill_fd, static_cast<off_t>(new_capacity * sizeof(T))) == -1)
+            throw std::system_error(errno, std::generic_category(), "failed to grow " + spill_file_path);
+
+        void *memory = mmap(nullptr, new_capacity * sizeof(T), PROT_READ | PROT_WRITE, MAP_SHARED, spill_fd, 0);
+        if (memory == MAP_FAILED)
+            throw std::system_error(errno, std::generic_category(), "failed to map " + spill_file_path);
+
+        if (spilled_states != nullptr)
+            munmap(spilled_states, spill_capacity * sizeof(T));
+
+        spilled_states = static_cast<T *>(memory);
+        spill_capacity = new_capacity;
+
+        // the ring was full, the states that wrapped around to the start of the file move to just past the old end so
+        // they follow the ones at [spill_head, old_capacity) again
+        size_t num_wrapped_states = spill_head + spilled_state_count - old_capacity;
+        if (spilled_state_count != 0 and num_wrapped_states != 0)
+            std::copy(spilled_states, spilled_states + num_wrapped_states, spilled_states + old_capacity);
+    }
+
+    static constexpr size_t initial_spill_capacity = 1024;
+
+    std::string spill_file_path;
+    size_t max_in_memory_states;
+    std::deque<T> in_memory_states;
+
+    int spill_fd = -1;
+    T *spilled_states = nullptr;
+    size_t spill_capacity = 0;
+    // the slot of the oldest spilled state, the spilled states wrap around the end of the file
+    size_t spill_head = 0;
+    size_t spilled_state_count = 0;
+};
+
+/**
+ * @brief A quantizer for spectator and replay clients which may hold a very long backlog, older states are spilled to
+ * disk through a `SpillingStateBuffer` so RAM use stays bounded while `update` keeps emitting at the quantized rate.
+ */
+template <typename T> class SpillingNetworkedPeriodicSignalQuantizer {
+  public:
+    SpillingNetworkedPeriodicSignalQuantizer(std::string spill_file_path, size_t max_in_memory_states)
+        : received_server_states(std::move(spill_file_path), max_in_memory_states) {}
+
+    ArrivalIntervalStatistics received_state_arrival_statistics;
+
+    PeriodicSignal output_signal{60};
+    SignalEmitter output_emitter;
+
+    unsigned int num_states_to_wait_for_after_empty = 4;
+
+    void push(const T &item) {
+        received_server_states.push_back(item);
+        received_state_arrival_statistics.record_arrival();
+
+        if (not pushed_first_element) {
+            pushed_first_element = true;
+            output_signal.restart();
+        }
+    }
+
+    void update() {
+        if (not pushed_first_element)
+            return;
+
+        if (not output_signal.process_and_get_signal())
+            return;
+
+        std::optional<T> emitted_value = std::nullopt;
+
+        if (emit_gate.on_emit_opportunity(received_server_states.size(), num_states_to_wait_for_after_empty) ==
+            QuantizedEmitGate::Decision::emit) {
+            emitted_value = received_server_states.front();
+            received_server_states.pop_front();
+            emit_gate.on_emitted(received_server_states.size());
+        }
+
+        output_emitter.emit(emitted_value);
+    }
+
+    size_t get_buffered_state_count() const { return received_server_states.size(); }
+    size_t get_spilled_state_count() const { return received_server_states.get_spilled_state_count(); }
+    double get_missed_emit_percentage() const { return emit_gate.get_missed_emit_percentage(); }
+
+  private:
+    SpillingStateBuffer<T> received_server_states;
+    QuantizedEmitGate emit_gate;
+    bool pushed_first_element = false;
+};
+
+#endif // NPSQ_HAS_POSIX_SHARED_MEMORY
+
 #endif // NETWORKED_PERIODIC_SIGNAL_QUANTIZER_HPP
@@ -0,0 +1,73 @@
+// the tick grid phase of QuantizedTickClock, and the arrival phase estimate a quantizer builds on top of it
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+
+using clock_type = QuantizedTickClock::clock;
+
+static std::chrono::nanoseconds cycles_to_duration(double cycles, std::chrono::nanoseconds period) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(cycles * std::chrono::duration<double>(period));
+}
+
+// the phase keeps following the grid after a deadline passed without the clock being processed
+static void test_phase_is_not_clamped_past_an_unprocessed_deadline() {
+    QuantizedTickClock tick_clock(100);
+    auto period = std::chrono::nanoseconds(tick_clock.get_period());
+    auto start = clock_type::now();
+    tick_clock.restart(start);
+
+    assert(std::abs(tick_clock.get_phase(start + cycles_to_duration(0.25, period)) - 0.25) < 1e-6);
+    assert(std::abs(tick_clock.get_phase(start + cycles_to_duration(1.5, period)) - 0.5) < 1e-6);
+    assert(std::abs(tick_clock.get_phase(start + cycles_to_duration(3.75, period)) - 0.75) < 1e-6);
+    assert(tick_clock.get_cycle_progress(start + cycles_to_duration(1.5, period)) == 1.0);
+
+    // before the first processed tick as well
+    assert(std::abs(tick_clock.get_phase(start - cycles_to_duration(0.25, period)) - 0.75) < 1e-6);
+}
+
+// states arrive at a fixed phase while update is only polled at a much lower frame rate, so most arrivals happen after
+// a deadline that hasn't been processed yet, the estimated arrival phase must still be the real one
+static void test_arrival_phase_estimate_with_frame_rate_polling() {
+    constexpr double output_rate_hz = 200;
+    constexpr double arrival_phase = 0.3;
+    constexpr int num_arrivals = 400;
+    const auto poll_interval = std::chrono::microseconds(16667);
+
+    NetworkedPeriodicSignalQuantizer<int> quantizer;
+    quantizer.output_signal.set_rate(output_rate_hz);
+    quantizer.emit_phase_adaptation.enabled = true;
+    // only measure, the phase must not move while we check the estimate
+    quantizer.emit_phase_adaptation.min_arrivals_before_adapting = std::numeric_limits<size_t>::max();
+
+    auto period = std::chrono::nanoseconds(quantizer.output_signal.get_period());
+
+    quantizer.push(0);
+    // the first push restarts the clock so its ticks are one period apart from here on
+    auto grid_origin = quantizer.output_signal.get_next_tick_time();
+    auto next_poll_time = clock_type::now() + poll_interval;
+
+    for (int i = 1; i <= num_arrivals; i++) {
+        auto arrival_time = grid_origin + period * i + cycles_to_duration(arrival_phase, period);
+        while (next_poll_time < arrival_time) {
+            std::this_thread::sleep_until(next_poll_time);
+            quantizer.update();
+            next_poll_time += poll_interval;
+        }
+        std::this_thread::sleep_until(arrival_time);
+        quantizer.push(i);
+    }
+
+    double estimated_phase = quantizer.arrival_phase_estimator.get_mean_phase();
+    double error = std::remainder(estimated_phase - arrival_phase, 1.0);
+    std::printf("estimated arrival phase %.3f, expected %.3f\n", estimated_phase, arrival_phase);
+    // sleep_until overshoots a little, which only ever makes arrivals later
+    assert(error > -0.02 and error < 0.1);
+}
+
+int main() {
+    test_phase_is_not_clamped_past_an_unprocessed_deadline();
+    test_arrival_phase_estimate_with_frame_rate_polling();
+    std::puts("arrival_phase_test passed");
+}
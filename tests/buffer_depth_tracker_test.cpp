@@ -0,0 +1,57 @@
+// checks for BufferDepthTracker, every timestamp is passed explicitly so nothing here depends on the wall clock
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cstdio>
+
+using clock_type = BufferDepthTracker::clock;
+
+// a depth that was held across buckets without new samples still counts for those buckets
+static void test_held_depth_fills_skipped_buckets() {
+    BufferDepthTracker tracker;
+    auto t0 = clock_type::now();
+    tracker.record(10, t0);
+    tracker.record(0, t0 + std::chrono::seconds(12));
+
+    auto now = t0 + std::chrono::seconds(12);
+    assert(tracker.get_max(now) == 10);
+    assert(tracker.get_min(now) == 0);
+    assert(tracker.get_current() == 0);
+}
+
+// once the window moved past a depth it is no longer reported
+static void test_depth_leaves_the_window() {
+    BufferDepthTracker tracker;
+    auto t0 = clock_type::now();
+    tracker.record(10, t0);
+    tracker.record(2, t0 + std::chrono::milliseconds(100));
+
+    auto later = t0 + std::chrono::milliseconds(100) + BufferDepthTracker::min_max_window +
+                 BufferDepthTracker::bucket_duration;
+    tracker.record(3, later);
+    assert(tracker.get_max(later) == 3);
+    assert(tracker.get_min(later) == 2);
+}
+
+// the average is weighted by how long each depth was held, not by how often it was recorded
+static void test_average_is_time_weighted() {
+    BufferDepthTracker tracker(std::chrono::seconds(1));
+    auto t0 = clock_type::now();
+    tracker.record(0, t0);
+    for (int i = 1; i <= 100; i++) {
+        // many samples at depth 8 over a short time barely move the average
+        tracker.record(8, t0 + std::chrono::microseconds(10 * i));
+    }
+    assert(tracker.get_average() < 0.1);
+
+    // holding depth 8 for five time constants brings the average close to it
+    tracker.record(8, t0 + std::chrono::seconds(5));
+    assert(tracker.get_average() > 7.9);
+}
+
+int main() {
+    test_held_depth_fills_skipped_buckets();
+    test_depth_leaves_the_window();
+    test_average_is_time_weighted();
+    std::puts("buffer_depth_tracker_test passed");
+}
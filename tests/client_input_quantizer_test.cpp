@@ -0,0 +1,72 @@
+// ClientInputQuantizer may merge inputs but never lose one, so the sum of every field has to survive overflow and skips
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cstdio>
+
+struct Input {
+    long dx = 0;
+};
+
+struct MergeInput {
+    void operator()(Input &newer, const Input &older) const { newer.dx += older.dx; }
+};
+
+using InputQuantizer = ClientInputQuantizer<Input, MergeInput>;
+
+static long sum_buffered(const InputQuantizer &quantizer) {
+    long sum = 0;
+    for (uint64_t tick = quantizer.get_next_emit_tick(); const Input *input = quantizer.get_state_at_tick(tick); tick++)
+        sum += input->dx;
+    return sum;
+}
+
+// overflow folds the oldest inputs into the ones after them, the buffer stays bounded and keeps the total
+static void test_overflow_merges_without_losing_input() {
+    InputQuantizer quantizer;
+    long pushed = 0;
+    for (long i = 1; i <= 50; i++) {
+        quantizer.push(Input{i});
+        pushed += i;
+        assert(quantizer.get_buffered_state_count() <= InputQuantizer::default_max_buffered_states);
+    }
+    assert(sum_buffered(quantizer) == pushed);
+}
+
+// skips from a playback speed above 1 and overflow from bursts happen together, what was emitted plus what is still
+// buffered must add up to what was pushed
+static void test_skips_and_overflow_conserve_input() {
+    InputQuantizer quantizer;
+    quantizer.output_signal.set_rate(500);
+    quantizer.set_playback_speed(3.0);
+    // each update emits at most one input, and the last emitted one stays readable
+    quantizer.stall_policy = QuantizerStallPolicy::emit_latest;
+    quantizer.retained_history_size = 1;
+
+    long pushed = 0;
+    long emitted = 0;
+    for (long i = 0; i < 200; i++) {
+        quantizer.push(Input{i});
+        pushed += i;
+        if (i % 3 == 0) {
+            quantizer.push(Input{1000});
+            pushed += 1000;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(1500));
+
+        uint64_t next_emit_tick = quantizer.get_next_emit_tick();
+        quantizer.update();
+        if (quantizer.get_next_emit_tick() != next_emit_tick)
+            emitted += quantizer.get_state_at_tick(quantizer.get_next_emit_tick() - 1)->dx;
+        assert(quantizer.get_buffered_state_count() <= InputQuantizer::default_max_buffered_states);
+    }
+
+    std::printf("pushed %ld, emitted %ld, still buffered %ld\n", pushed, emitted, sum_buffered(quantizer));
+    assert(emitted + sum_buffered(quantizer) == pushed);
+}
+
+int main() {
+    test_overflow_merges_without_losing_input();
+    test_skips_and_overflow_conserve_input();
+    std::puts("client_input_quantizer_test passed");
+}
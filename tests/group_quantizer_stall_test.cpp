@@ -0,0 +1,78 @@
+// a hitch in update() calls must cost the tick group and world snapshot quantizers the same states it costs the main
+// quantizer, otherwise they are left with more buffered ticks and so more latency after every hitch
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cstdio>
+
+using clock_type = QuantizedTickClock::clock;
+
+struct IntAccessor {
+    std::optional<const int *> operator()(const int &snapshot, int) const { return &snapshot; }
+};
+
+constexpr double rate_hz = 50;
+constexpr int num_pushed_ticks = 10;
+
+// updates once half a period after the first tick and once more half a period after the fourth, so the second update
+// sees three elapsed ticks. The first tick is always a miss that ends the initial refill, which leaves three ticks that
+// each consume a state.
+template <typename Quantizer> static void run_with_a_three_tick_hitch(Quantizer &quantizer) {
+    auto period = quantizer.output_signal.get_period();
+    auto first_tick_time = quantizer.output_signal.get_next_tick_time();
+    std::this_thread::sleep_until(first_tick_time + period / 2);
+    quantizer.update();
+    std::this_thread::sleep_until(first_tick_time + period * 3 + period / 2);
+    quantizer.update();
+}
+
+static void test_tick_group_handles_every_elapsed_tick() {
+    for (QuantizerStallPolicy policy : {QuantizerStallPolicy::emit_every_tick, QuantizerStallPolicy::emit_latest}) {
+        // the first push starts the clock, so each quantizer is filled right before its own run
+        NetworkedTickGroupQuantizer<int, int> group;
+        group.output_signal.set_rate(rate_hz);
+        group.stall_policy = policy;
+        group.get_member_emitter(0);
+        for (int tick = 1; tick <= num_pushed_ticks; tick++)
+            group.push(0, tick, tick);
+        run_with_a_three_tick_hitch(group);
+
+        NetworkedPeriodicSignalQuantizer<int> reference;
+        reference.output_signal.set_rate(rate_hz);
+        reference.stall_policy = policy;
+        for (int tick = 1; tick <= num_pushed_ticks; tick++)
+            reference.push(tick);
+        run_with_a_three_tick_hitch(reference);
+
+        std::printf("tick group buffered %zu, main quantizer buffered %zu\n", group.get_buffered_tick_count(),
+                    reference.get_buffered_state_count());
+        assert(group.get_buffered_tick_count() == num_pushed_ticks - 3);
+        assert(group.get_buffered_tick_count() == reference.get_buffered_state_count());
+        assert(group.get_last_emitted_server_tick() == std::optional<uint64_t>(3));
+        assert(group.get_last_update_skipped_ticks() == reference.get_last_update_skipped_ticks());
+    }
+}
+
+static void test_world_snapshot_handles_every_elapsed_tick() {
+    for (QuantizerStallPolicy policy : {QuantizerStallPolicy::emit_every_tick, QuantizerStallPolicy::emit_latest}) {
+        WorldSnapshotQuantizer<int, int, IntAccessor> world;
+        world.output_signal.set_rate(rate_hz);
+        world.stall_policy = policy;
+        for (int tick = 1; tick <= num_pushed_ticks; tick++)
+            world.push(int(tick));
+
+        run_with_a_three_tick_hitch(world);
+
+        assert(world.get_buffered_snapshot_count() == num_pushed_ticks - 3);
+        assert(world.get_current_snapshot() != nullptr);
+        assert(*world.get_current_snapshot() == 3);
+        std::optional<const int *> view = world.get_entity_view(0);
+        assert(view.has_value() and **view == 3);
+    }
+}
+
+int main() {
+    test_tick_group_handles_every_elapsed_tick();
+    test_world_snapshot_handles_every_elapsed_tick();
+    std::puts("group_quantizer_stall_test passed");
+}
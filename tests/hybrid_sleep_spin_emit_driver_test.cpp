@@ -0,0 +1,55 @@
+// runs HybridSleepSpinEmitDriver against the real clock, so the timing bounds are loose enough for a loaded machine
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cstdio>
+
+// a producer thread pushes at 500hz through the driver while the driver thread emits, every emit must be measured
+// from the moment it happened and none can happen before its deadline
+static void test_driver_emits_at_500hz_with_a_separate_producer_thread() {
+    using clock = std::chrono::steady_clock;
+    constexpr size_t num_emits = 300;
+
+    NetworkedPeriodicSignalQuantizer<int> quantizer;
+    quantizer.output_signal.set_rate(500);
+    HybridSleepSpinEmitDriver driver(quantizer);
+
+    std::atomic<bool> keep_producing{true};
+    std::thread producer([&] {
+        auto next_push_time = clock::now();
+        for (int state = 0; keep_producing.load(std::memory_order_relaxed); state++) {
+            driver.push(state);
+            next_push_time += std::chrono::microseconds(2000);
+            std::this_thread::sleep_until(next_push_time);
+        }
+    });
+
+    while (driver.get_emit_error_histogram().get_sample_count() < num_emits)
+        driver.run_once();
+
+    keep_producing = false;
+    producer.join();
+
+    const EmitTimingErrorHistogram &histogram = driver.get_emit_error_histogram();
+    std::printf("emits %zu, mean error %.1fus, max error %lldus, within 100us %.1f%%\n", histogram.get_sample_count(),
+                histogram.get_mean_error_us(),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(histogram.get_max_error())
+                                           .count()),
+                histogram.get_fraction_within(std::chrono::microseconds(100)) * 100.0);
+
+    assert(histogram.get_sample_count() == num_emits);
+    assert(histogram.get_early_count() == 0);
+    // loose on purpose, a loaded machine can miss a few deadlines, but most emits must land well within a period
+    assert(histogram.get_fraction_within(std::chrono::microseconds(1000)) >= 0.9);
+
+    // pushes went through the driver while it was sleeping and spinning, so apart from the initial refill every emit
+    // found a state to emit
+    double missed_emit_percentage = driver.with_locked_quantizer(
+        [](const NetworkedPeriodicSignalQuantizer<int> &q) { return q.get_missed_emit_percentage(); });
+    assert(missed_emit_percentage < 10.0);
+}
+
+int main() {
+    test_driver_emits_at_500hz_with_a_separate_producer_thread();
+    std::puts("hybrid_sleep_spin_emit_driver_test passed");
+}
@@ -0,0 +1,99 @@
+// push_with_redundancy bookkeeping, read back through get_state_at_tick so nothing here needs the clock to tick
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+static std::vector<int> get_buffered_states(const NetworkedPeriodicSignalQuantizer<int> &quantizer) {
+    std::vector<int> states;
+    for (uint64_t tick = quantizer.get_next_emit_tick(); const int *state = quantizer.get_state_at_tick(tick); tick++)
+        states.push_back(*state);
+    return states;
+}
+
+// a gap is filled from the redundant states the next packet carries
+static void test_gap_is_filled_from_redundant_states() {
+    NetworkedPeriodicSignalQuantizer<int> quantizer;
+    quantizer.push_with_redundancy(1, 1);
+    const int redundant[] = {3, 2};
+    quantizer.push_with_redundancy(4, 4, redundant, 2);
+
+    assert((get_buffered_states(quantizer) == std::vector<int>{1, 2, 3, 4}));
+    assert(quantizer.get_states_recovered_from_redundancy() == 2);
+    assert(quantizer.get_states_lost() == 0);
+    assert(quantizer.get_duplicate_states_ignored() == 0);
+}
+
+// a packet that arrives after the one following it goes in its place, not at the back
+static void test_late_state_is_inserted_in_order() {
+    NetworkedPeriodicSignalQuantizer<int> quantizer;
+    quantizer.push_with_redundancy(5, 5);
+    quantizer.push_with_redundancy(7, 7);
+    assert(quantizer.get_states_lost() == 1);
+
+    quantizer.push_with_redundancy(6, 6);
+    assert((get_buffered_states(quantizer) == std::vector<int>{5, 6, 7}));
+    assert(quantizer.get_states_lost() == 0);
+    assert(quantizer.get_duplicate_states_ignored() == 0);
+
+    quantizer.push_with_redundancy(6, 6);
+    assert(quantizer.get_duplicate_states_ignored() == 1);
+    assert(quantizer.get_buffered_state_count() == 3);
+}
+
+// redundant states of a later packet also fill gaps that earlier packets left behind
+static void test_older_gap_is_filled_by_a_later_packet() {
+    NetworkedPeriodicSignalQuantizer<int> quantizer;
+    quantizer.push_with_redundancy(1, 1);
+    quantizer.push_with_redundancy(4, 4);
+    assert(quantizer.get_states_lost() == 2);
+
+    const int redundant[] = {4, 3, 2};
+    quantizer.push_with_redundancy(5, 5, redundant, 3);
+    assert((get_buffered_states(quantizer) == std::vector<int>{1, 2, 3, 4, 5}));
+    assert(quantizer.get_states_lost() == 0);
+    assert(quantizer.get_states_recovered_from_redundancy() == 2);
+}
+
+// once the states after a gap are gone, the missing state can't be placed anymore
+static void test_state_behind_the_cursor_is_dropped() {
+    NetworkedPeriodicSignalQuantizer<int> quantizer;
+    quantizer.max_buffered_states = 4;
+    quantizer.push_with_redundancy(1, 1);
+    for (int sequence = 3; sequence <= 7; sequence++)
+        quantizer.push_with_redundancy(sequence, sequence);
+    assert((get_buffered_states(quantizer) == std::vector<int>{4, 5, 6, 7}));
+
+    quantizer.push_with_redundancy(2, 2);
+    assert((get_buffered_states(quantizer) == std::vector<int>{4, 5, 6, 7}));
+    assert(quantizer.get_late_states_dropped() == 1);
+    assert(quantizer.get_states_lost() == 1);
+    assert(quantizer.get_duplicate_states_ignored() == 0);
+}
+
+// a sequence far behind the newest one is a server restart, not a duplicate
+static void test_large_backwards_jump_resets_the_sequence() {
+    NetworkedPeriodicSignalQuantizer<int> quantizer;
+    quantizer.push_with_redundancy(5000, 1);
+    quantizer.push_with_redundancy(5001, 2);
+    quantizer.push_with_redundancy(1, 3);
+    quantizer.push_with_redundancy(2, 4);
+
+    assert((get_buffered_states(quantizer) == std::vector<int>{1, 2, 3, 4}));
+    assert(quantizer.get_duplicate_states_ignored() == 0);
+    assert(quantizer.get_states_lost() == 0);
+
+    quantizer.reset_sequence();
+    quantizer.push_with_redundancy(1, 5);
+    assert((get_buffered_states(quantizer) == std::vector<int>{1, 2, 3, 4, 5}));
+}
+
+int main() {
+    test_gap_is_filled_from_redundant_states();
+    test_late_state_is_inserted_in_order();
+    test_older_gap_is_filled_by_a_later_packet();
+    test_state_behind_the_cursor_is_dropped();
+    test_large_backwards_jump_resets_the_sequence();
+    std::puts("redundant_push_test passed");
+}
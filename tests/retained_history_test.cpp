@@ -0,0 +1,44 @@
+// tick numbering of get_state_at_tick, overflow moves the emit cursor the same way emits do so no clock is needed
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cstdio>
+
+// every state keeps the tick it was pushed as, and only the last retained_history_size passed states stay readable
+static void test_ticks_follow_the_push_order() {
+    NetworkedPeriodicSignalQuantizer<int> quantizer;
+    quantizer.retained_history_size = 3;
+    quantizer.max_buffered_states = 4;
+    for (int i = 0; i < 10; i++)
+        quantizer.push(i);
+
+    assert(quantizer.get_buffered_state_count() == 4);
+    assert(quantizer.get_next_emit_tick() == 6);
+    assert(quantizer.get_oldest_stored_tick() == 3);
+    for (uint64_t tick = 3; tick < 10; tick++) {
+        const int *state = quantizer.get_state_at_tick(tick);
+        assert(state != nullptr and *state == static_cast<int>(tick));
+    }
+    assert(quantizer.get_state_at_tick(2) == nullptr);
+    assert(quantizer.get_state_at_tick(10) == nullptr);
+}
+
+// without retention a passed state is discarded right away, the tick count carries on regardless
+static void test_ticks_without_retention() {
+    NetworkedPeriodicSignalQuantizer<int> quantizer;
+    quantizer.max_buffered_states = 4;
+    for (int i = 0; i < 10; i++)
+        quantizer.push(i);
+
+    assert(quantizer.get_oldest_stored_tick() == 6);
+    assert(quantizer.get_next_emit_tick() == 6);
+    assert(quantizer.get_state_at_tick(5) == nullptr);
+    const int *state = quantizer.get_state_at_tick(6);
+    assert(state != nullptr and *state == 6);
+}
+
+int main() {
+    test_ticks_follow_the_push_order();
+    test_ticks_without_retention();
+    std::puts("retained_history_test passed");
+}
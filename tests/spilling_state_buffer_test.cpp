@@ -0,0 +1,81 @@
+// SpillingStateBuffer keeps its spill file as a ring, these check the states come back in order and that the file
+// stops growing once the backlog is steady
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <sys/stat.h>
+
+static off_t get_file_size(const std::string &path) {
+    struct stat file_status {};
+    [[maybe_unused]] int result = stat(path.c_str(), &file_status);
+    assert(result == 0);
+    return file_status.st_size;
+}
+
+// a constant backlog must keep the spill file at a constant size no matter how many states go through it
+static void test_steady_state_spill_file_size_is_bounded() {
+    const std::string path = "/tmp/npsq_spill_steady_state_test.bin";
+    SpillingStateBuffer<uint64_t> buffer(path, 2);
+
+    uint64_t next_pushed = 0;
+    uint64_t next_expected = 0;
+    for (int i = 0; i < 10; i++)
+        buffer.push_back(next_pushed++);
+
+    assert(buffer.get_spilled_state_count() == 8);
+    [[maybe_unused]] size_t capacity_after_warmup = buffer.get_spill_file_capacity();
+    [[maybe_unused]] off_t file_size_after_warmup = get_file_size(path);
+
+    for (int i = 0; i < 100'000; i++) {
+        buffer.push_back(next_pushed++);
+        assert(buffer.front() == next_expected);
+        buffer.pop_front();
+        next_expected++;
+    }
+
+    assert(buffer.size() == 10);
+    assert(buffer.get_spill_file_capacity() == capacity_after_warmup);
+    assert(get_file_size(path) == file_size_after_warmup);
+
+    while (not buffer.empty()) {
+        assert(buffer.front() == next_expected);
+        buffer.pop_front();
+        next_expected++;
+    }
+    assert(next_expected == next_pushed);
+}
+
+// growing while the ring has wrapped around the end of the file must keep the states in order
+static void test_growing_a_wrapped_spill_file_keeps_fifo_order() {
+    const std::string path = "/tmp/npsq_spill_grow_test.bin";
+    SpillingStateBuffer<uint64_t> buffer(path, 0);
+
+    uint64_t next_pushed = 0;
+    uint64_t next_expected = 0;
+    for (int i = 0; i < 1000; i++)
+        buffer.push_back(next_pushed++);
+    for (int i = 0; i < 600; i++) {
+        assert(buffer.front() == next_expected);
+        buffer.pop_front();
+        next_expected++;
+    }
+
+    // wraps around the end of the initial capacity, then forces it to grow
+    for (int i = 0; i < 5000; i++)
+        buffer.push_back(next_pushed++);
+    assert(buffer.get_spill_file_capacity() > 1024);
+
+    while (not buffer.empty()) {
+        assert(buffer.front() == next_expected);
+        buffer.pop_front();
+        next_expected++;
+    }
+    assert(next_expected == next_pushed);
+}
+
+int main() {
+    test_steady_state_spill_file_size_is_bounded();
+    test_growing_a_wrapped_spill_file_keeps_fifo_order();
+    std::puts("spilling_state_buffer_test passed");
+}
@@ -0,0 +1,74 @@
+// how the ticks that elapsed between two update() calls turn into emit opportunities under each QuantizerStallPolicy
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+static std::vector<size_t> get_opportunities(size_t num_elapsed_ticks, QuantizerStallPolicy policy,
+                                             size_t max_ticks_per_update, size_t &num_skipped_ticks) {
+    std::vector<size_t> opportunities;
+    num_skipped_ticks = handle_elapsed_ticks(num_elapsed_ticks, policy, max_ticks_per_update,
+                                             [&](size_t num_ticks) { opportunities.push_back(num_ticks); });
+    return opportunities;
+}
+
+static void test_emit_every_tick() {
+    size_t num_skipped_ticks = 0;
+    assert(get_opportunities(0, QuantizerStallPolicy::emit_every_tick, 8, num_skipped_ticks).empty());
+    assert(num_skipped_ticks == 0);
+
+    assert((get_opportunities(3, QuantizerStallPolicy::emit_every_tick, 8, num_skipped_ticks) ==
+            std::vector<size_t>{1, 1, 1}));
+    assert(num_skipped_ticks == 0);
+
+    // past the limit the last opportunity stands in for the remaining ticks, so every elapsed tick still advances
+    assert((get_opportunities(5, QuantizerStallPolicy::emit_every_tick, 2, num_skipped_ticks) ==
+            std::vector<size_t>{1, 4}));
+    assert(num_skipped_ticks == 3);
+
+    // a limit of 0 behaves like 1
+    assert((get_opportunities(3, QuantizerStallPolicy::emit_every_tick, 0, num_skipped_ticks) ==
+            std::vector<size_t>{3}));
+    assert(num_skipped_ticks == 2);
+}
+
+static void test_emit_latest() {
+    size_t num_skipped_ticks = 0;
+    assert((get_opportunities(1, QuantizerStallPolicy::emit_latest, 8, num_skipped_ticks) == std::vector<size_t>{1}));
+    assert(num_skipped_ticks == 0);
+
+    assert((get_opportunities(4, QuantizerStallPolicy::emit_latest, 8, num_skipped_ticks) == std::vector<size_t>{4}));
+    assert(num_skipped_ticks == 3);
+}
+
+// a hitch consumes one state per elapsed tick under both policies, so it doesn't leave extra latency behind
+static void test_quantizer_consumes_a_state_per_elapsed_tick() {
+    for (QuantizerStallPolicy policy : {QuantizerStallPolicy::emit_every_tick, QuantizerStallPolicy::emit_latest}) {
+        NetworkedPeriodicSignalQuantizer<int> quantizer;
+        quantizer.output_signal.set_rate(50);
+        quantizer.stall_policy = policy;
+        quantizer.max_ticks_per_update = 2;
+        for (int i = 0; i < 10; i++)
+            quantizer.push(i);
+
+        // the first tick ends the initial refill without emitting, then five ticks elapse before the next update
+        auto period = quantizer.output_signal.get_period();
+        auto first_tick_time = quantizer.output_signal.get_next_tick_time();
+        std::this_thread::sleep_until(first_tick_time + period / 2);
+        quantizer.update();
+        std::this_thread::sleep_until(first_tick_time + period * 5 + period / 2);
+        quantizer.update();
+
+        assert(quantizer.get_buffered_state_count() == 5);
+        assert(quantizer.get_next_emit_tick() == 5);
+        assert(quantizer.get_last_update_skipped_ticks() == (policy == QuantizerStallPolicy::emit_latest ? 4 : 3));
+    }
+}
+
+int main() {
+    test_emit_every_tick();
+    test_emit_latest();
+    test_quantizer_consumes_a_state_per_elapsed_tick();
+    std::puts("stall_policy_test passed");
+}
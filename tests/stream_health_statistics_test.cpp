@@ -0,0 +1,104 @@
+// the per stream health bookkeeping: windowed miss rates, the top-K worst streams and the health report wire format
+#include "../networked_periodic_signal_quantizer.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+using clock_type = WindowedEmitCounter::clock;
+
+// only the buckets inside the window count, and a window is rounded up to whole buckets
+static void test_windowed_emit_counter() {
+    WindowedEmitCounter counter;
+    auto t0 = clock_type::now();
+
+    for (int i = 0; i < 10; i++)
+        counter.record(true, t0);
+    assert(counter.get_missed_emit_percentage(std::chrono::seconds(1), t0) == 100.0);
+
+    // two seconds later the misses fall out of a one second window but not out of a five second one
+    auto t1 = t0 + std::chrono::seconds(2);
+    for (int i = 0; i < 30; i++)
+        counter.record(false, t1);
+    assert(counter.get_missed_emit_percentage(std::chrono::seconds(1), t1) == 0.0);
+    assert(counter.get_missed_emit_percentage(std::chrono::seconds(5), t1) == 25.0);
+
+    // a window shorter than a bucket still covers the current bucket
+    counter.record(true, t1);
+    double percentage = counter.get_missed_emit_percentage(std::chrono::milliseconds(1), t1);
+    assert(percentage > 3.2 and percentage < 3.3);
+
+    // once the whole ring has been lapped nothing old is left
+    auto t2 = t1 + WindowedEmitCounter::max_window * 2;
+    assert(counter.get_missed_emit_percentage(WindowedEmitCounter::max_window, t2) == 0.0);
+}
+
+static std::vector<uint64_t> get_worst_stream_ids(const WorstStreamTracker &tracker) {
+    std::vector<uint64_t> stream_ids;
+    for (const auto &[stream_id, score] : tracker.get_worst_streams())
+        stream_ids.push_back(stream_id);
+    return stream_ids;
+}
+
+static void test_worst_stream_tracker_keeps_the_top_k() {
+    WorstStreamTracker tracker(3);
+    for (uint64_t stream_id = 0; stream_id < 10; stream_id++)
+        tracker.report(stream_id, static_cast<double>(stream_id));
+    assert((get_worst_stream_ids(tracker) == std::vector<uint64_t>{9, 8, 7}));
+
+    // a tracked stream that improves sinks, and is pushed out by the next stream that scores higher
+    tracker.report(9, 0.5);
+    assert((get_worst_stream_ids(tracker) == std::vector<uint64_t>{8, 7, 9}));
+    tracker.report(4, 4.0);
+    assert((get_worst_stream_ids(tracker) == std::vector<uint64_t>{8, 7, 4}));
+
+    // a tracked stream that gets worse rises
+    tracker.report(4, 20.0);
+    assert((get_worst_stream_ids(tracker) == std::vector<uint64_t>{4, 8, 7}));
+
+    // a score too low to enter is rejected, a removed stream leaves room
+    tracker.report(1, 1.0);
+    assert((get_worst_stream_ids(tracker) == std::vector<uint64_t>{4, 8, 7}));
+    tracker.remove(8);
+    assert((get_worst_stream_ids(tracker) == std::vector<uint64_t>{4, 7}));
+    tracker.report(1, 1.0);
+    assert((get_worst_stream_ids(tracker) == std::vector<uint64_t>{4, 7, 1}));
+    assert(tracker.get_worst_streams().front().second == 20.0);
+}
+
+static void test_worst_stream_tracker_with_k_zero() {
+    WorstStreamTracker tracker(0);
+    tracker.report(1, 100.0);
+    assert(tracker.get_worst_streams().empty());
+}
+
+static void test_health_report_round_trip() {
+    QuantizerHealthReport report;
+    report.buffered_state_count = 0x1234;
+    report.average_buffered_state_count_centi = 0xabcd;
+    report.underrun_count = 0x89abcdef;
+    report.missed_emit_basis_points = 10000;
+    report.reserved = 0;
+    report.drift_ppm = -1500;
+
+    std::array<uint8_t, QuantizerHealthReport::serialized_size> bytes = report.serialize();
+    // little endian, fields in declaration order
+    assert(bytes[0] == 0x34 and bytes[1] == 0x12);
+    assert(bytes[4] == 0xef and bytes[7] == 0x89);
+
+    QuantizerHealthReport decoded = QuantizerHealthReport::deserialize(bytes);
+    assert(decoded.buffered_state_count == report.buffered_state_count);
+    assert(decoded.average_buffered_state_count_centi == report.average_buffered_state_count_centi);
+    assert(decoded.underrun_count == report.underrun_count);
+    assert(decoded.missed_emit_basis_points == report.missed_emit_basis_points);
+    assert(decoded.reserved == report.reserved);
+    assert(decoded.drift_ppm == report.drift_ppm);
+}
+
+int main() {
+    test_windowed_emit_counter();
+    test_worst_stream_tracker_keeps_the_top_k();
+    test_worst_stream_tracker_with_k_zero();
+    test_health_report_round_trip();
+    std::puts("stream_health_statistics_test passed");
+}